@@ -0,0 +1,182 @@
+/*******************************************************************************
+	algomath.h -- 特殊関数・統計関数の公開ヘッダ
+	loggamma.c, normpdf.c, binomial.c, nnint.c, quadrant.c, power.cの
+	外から呼べる関数と型。libalgoc.a / libalgoc.soと一緒に使う。
+	配列版(xxx_batch)のうちSIMDのあるものは，ライブラリでは基本・AVX2・AVX-512の
+	3通りに翻訳され，初めて呼んだときにCPUに合うものが選ばれる(dispatch.c)。
+*******************************************************************************/
+#ifndef ALGOMATH_H
+#define ALGOMATH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* loggamma.c -- ガンマ関数の対数, ベータ関数, ディガンマ関数 */
+double loggamma(double);
+void loggamma_batch(int, const double *, double *);
+double lbeta(double, double);
+double beta(double, double);
+void lbeta_batch(int, const double *, const double *, double *);
+void beta_batch(int, const double *, const double *, double *);
+void loggamma_psi(double, double *, double *, double *);
+void loggamma_psi_batch(int, const double *, double *, double *, double *);
+double digamma(double);
+double trigamma(double);
+float loggammaf(float);
+long double loggammal(long double);
+#ifdef LOGGAMMA_QUAD  /* -DLOGGAMMA_QUAD -lquadmath */
+__float128 loggammaq(__float128);
+#endif
+
+/* normpdf.c -- 正規分布の確率密度 */
+double snormpdf(double);
+double normpdf(double, double, double);
+double lognormpdf(double, double, double);
+
+/* binomial.c -- 2項分布 */
+typedef struct BinomParam {
+	int k, n;
+	int lo, hi;  /* 列挙する範囲 */
+	double p, q, s, t;
+	int status;
+} binom_param_t ;
+
+typedef struct BinomSampler {
+	int n;
+	int swap;  /* p > 0.5なら1-pで引いてn-xを返す */
+	int btpe;  /* 0: 逆関数法, 1: BTPE */
+	double r, q;
+	/* 逆関数法 */
+	double qn, bound;
+	/* BTPE */
+	int m;
+	double nrq, xm, xl, xr, c, laml, lamr, p1, p2, p3, p4, lfm;
+	uint64_t state;  /* xorshift64* */
+} binom_sampler_t ;
+
+typedef struct BinomCacheStats {
+	unsigned long hits, misses, evictions;
+} binom_cache_stats_t ;
+
+/* 近似エンジンの結果 */
+#define BINOM_EXACT   0
+#define BINOM_POISSON 1
+#define BINOM_NORMAL  2
+typedef struct BinomApprox {
+	double value;  /* 近似値 */
+	double bound;  /* |近似値 - 真値|の上界 */
+	int method;    /* BINOM_EXACT, BINOM_POISSON, BINOM_NORMAL */
+} binom_approx_t ;
+
+void binom_param_nu_set(binom_param_t *, int);
+void binom_param_phi_set(binom_param_t *, double);
+int logfact_set_bound(int);
+double logfact(int);
+double lchoose(int, int);
+double binompmf(int, int, double);
+double binomcdf(int, int, double);
+double binomsf(int, int, double);
+void binomcdf_batch(int, const int *, const int *, const double *, double *);
+void binomsf_batch(int, const int *, const int *, const double *, double *);
+void binom_enum_initialize(int, double, binom_param_t *);
+void binom_each_yield(binom_param_t *);
+int binom_fill(int, double, double *, double *, int, int);
+void binom_sampler_initialize(int, double, uint64_t, binom_sampler_t *);
+int binom_sample(binom_sampler_t *);
+void binom_sample_fill(binom_sampler_t *, int *, int);
+double binom_cache_cdf(int, int, double);
+int binom_cache_quantile(double, int, double);
+void binom_cache_sample_fill(int, double, const double *, int *, int);
+void binom_cache_stats(binom_cache_stats_t *);
+int binompmf_grid(int, const int *, int, const int *, int, const double *, double *, int);
+binom_approx_t binompmf_approx(int, int, double, double);
+binom_approx_t binomcdf_approx(int, int, double, double);
+
+/* nnint.c -- 最も近い整数 */
+/* 配列版の丸めの種類 */
+enum {
+	NNINT_FLOOR,     /* 床 */
+	NNINT_CEIL,      /* 天井 */
+	NNINT_TRUNC,     /* 0の方向へ */
+	NNINT_ROUND,     /* 四捨五入 (0.5は0から遠い方へ) */
+	NNINT_ROUNDEVEN, /* 偶数丸め */
+	NNINT_NEARBYINT  /* 現在の丸めモード */
+};
+
+double my_floor_bisect(double);
+double my_ceil_bisect(double);
+double my_trunc_bisect(double);
+double my_floor(double);
+double my_ceil(double);
+double my_trunc(double);
+double my_round(double);
+double my_roundeven(double);
+double my_nearbyint(double);
+int nnint_round_array(int, int, const double *, double *);
+int nnint_round_arrayf(int, int, const float *, float *);
+int nnint_round_i32(int, int, const double *, int32_t *);
+int nnint_round_i64(int, int, const double *, int64_t *);
+int nnint_round_i32f(int, int, const float *, int32_t *);
+int nnint_round_i64f(int, int, const float *, int64_t *);
+double floor10(double, int);
+double ceil10(double, int);
+double round10(double, int);
+void floor10_batch(int, const double *, int, double *);
+void ceil10_batch(int, const double *, int, double *);
+void round10_batch(int, const double *, int, double *);
+
+/* quadrant.c -- 象限と偏角 */
+#define QUADRANT_NCODES 16  /* quadrant_classify()の符号の数 */
+
+double quadrant(double, double);
+float quadrantf(float, float);
+void quadrant_batch(int, const double *, const double *, double *);
+void quadrantf_batch(int, const float *, const float *, float *);
+void cart2polar(const double *, const double *, double *, double *, int);
+void cart2polar_complex(const double *, double *, double *, int);
+void polar2cart(const double *, const double *, double *, double *, int);
+int quadrant_classify(double, double);
+void quadrant_decode(int, int *, int *);
+void quadrant_classify_batch(int, const double *, const double *, unsigned char *);
+int quadrant_histogram(const double *, const double *, int, uint64_t []);
+
+/* power.c -- 整数乗・有理数乗 */
+double powi(double, int);
+double pow_ratio(double, int, int);
+double pow_signed(double, double);
+void powi_batch(int, const double *, int, double *);
+void pow_ratio_batch(int, const double *, int, int, double *);
+void pow_signed_batch(int, const double *, double, double *);
+
+/* $|n| \leq 4$は掛け算の手順を呼び出し側に展開し，それ以外はライブラリのpowi()を
+ * 呼ぶ。nが定数ならswitchは消えて掛け算だけが残る。結果はライブラリのpowi()と
+ * ビットまで同じ。関数のアドレスが要るときは(powi)と括弧で囲む。
+ */
+static inline double
+powi_inline(double x, int n)
+{
+	double x2;
+
+	switch (n) {
+	case -4: x2 = x * x;  return 1.0 / (x2 * x2);
+	case -3: return 1.0 / (x * x * x);
+	case -2: return 1.0 / (x * x);
+	case -1: return 1.0 / x;
+	case 0:  return 1.0;
+	case 1:  return x;
+	case 2:  return x * x;
+	case 3:  return x * x * x;
+	case 4:  x2 = x * x;  return x2 * x2;
+	default: return (powi)(x, n);
+	}
+}
+#define powi(x, n)  powi_inline(x, n)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALGOMATH_H */
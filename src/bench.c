@@ -0,0 +1,405 @@
+/*******************************************************************************
+	bench.c -- 特殊関数の速度と精度の検証
+	loggamma, snormpdf/normpdf/lognormpdf, binompmf, my_floor/my_ceil/my_trunc
+	(とnnint_round_array),
+	quadrant, powi, 符号化器(lpcm_codec, pcmu_codec, pcma_codec)について，
+	スカラー版と配列版の1回あたりの時間(ns/call, calls/sec)と，
+	拡張倍精度(long double)の参照値に対する最大・平均のulp誤差を求め，JSONで出す。
+	リリースごとに出力を比べれば，速度や精度の後退に気づける。
+
+	make bench (libalgoc.aとリンクする)
+	make PROBE=1 benchなら計数器を入れた版で測り，数えた値も"probes"に出す。
+	入れない版と比べれば計数器の手間がわかる。
+	または gcc -O2 -DALGO_NO_MAIN bench.c loggamma.c normpdf.c binomial.c nnint.c \
+	    quadrant.c power.c codec_pcm.c codec_pcmu.c codec_pcma.c -lm -lpthread
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include "algomath.h"  /* 検証する関数 */
+#include "pio.h"
+#include "probe.h"
+
+#define LEN (1 << 20)
+#define CHUNK 4096  /* 符号化器の配列版を1回に呼ぶ標本数 (pcmconv.cと同じ) */
+#define PI  3.14159265358979323846
+
+static double xs[LEN], ys[LEN], out[LEN];
+static long double ref[LEN];
+static int first = 1;
+
+/* 経過時間[ns] */
+static double
+now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* 参照値に対する誤差をulp単位で。flooredなら$\max(|f|, 1)$のulpで測る */
+static double
+ulp_error(double got, long double r, int floored)
+{
+	double a, u;
+
+	if (got != got || r != r)
+		return (got != got && r != r) ? 0 : HUGE_VAL;
+	if (got == r)
+		return 0;
+	if (isinf(got) || isinf((double)r))
+		return HUGE_VAL;
+	a = fabs((double)r);
+	if (floored && a < 1)  a = 1;
+	u = a == 0 ? DBL_TRUE_MIN : nextafter(a, HUGE_VAL) - a;
+	return (double)(fabsl(got - r) / u);
+}
+
+/* JSONの1件 */
+static void
+report(const char *name, const char *form, const char *domain, int n, double ns, int floored)
+{
+	double e, emax = 0, esum = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		e = ulp_error(out[i], ref[i], floored);
+		if (e > emax)  emax = e;
+		esum += e;
+	}
+	printf("%s    {\"name\": \"%s\", \"form\": \"%s\", \"domain\": \"%s\", \"n\": %d, "
+	       "\"ns_per_call\": %.3f, \"calls_per_sec\": %.4g, \"max_ulp\": %.3f, \"mean_ulp\": %.4f}",
+	       first ? "" : ",\n", name, form, domain, n, ns / n, 1e9 * n / ns, emax, esum / n);
+	first = 0;
+}
+
+/* 一様乱数 [0, 1) */
+static double
+unif(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+/*------------------------------------------------------------------------------
+	ガンマ関数の対数
+------------------------------------------------------------------------------*/
+static void
+bench_loggamma(void)
+{
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)  /* 密: (0, 100] */
+		xs[i] = 100.0 * (i + 1) / LEN;
+	for (i = 0; i < LEN; i++)  ref[i] = lgammal(xs[i]);
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = loggamma(xs[i]);
+	report("loggamma", "scalar", "dense(0,100]", LEN, now_ns() - t, 1);
+	t = now_ns();
+	loggamma_batch(LEN, xs, out);
+	report("loggamma", "batch", "dense(0,100]", LEN, now_ns() - t, 1);
+
+	for (i = 0; i < LEN; i++)  /* 乱: $\pm 2^{-20}$から$2^{40}$まで対数一様，負は非整数 */
+	{
+		xs[i] = ldexp(1.0 + unif(), rand() % 60 - 20);
+		if (i % 4 == 0)  xs[i] = -(floor(fmod(xs[i], 1e6)) + 0.03125 + 0.9 * unif());
+	}
+	for (i = 0; i < LEN; i++)  ref[i] = lgammal(xs[i]);
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = loggamma(xs[i]);
+	report("loggamma", "scalar", "random", LEN, now_ns() - t, 1);
+	t = now_ns();
+	loggamma_batch(LEN, xs, out);
+	report("loggamma", "batch", "random", LEN, now_ns() - t, 1);
+}
+
+/*------------------------------------------------------------------------------
+	正規分布
+------------------------------------------------------------------------------*/
+#define SQRT2PI_L 2.50662827463100050241576528481104525L
+
+static void
+bench_normpdf(void)
+{
+	const double mu = 1.5, sigma = 2.5, lmu = 0.5, lsigma = 1.2;
+	long double z;
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)  /* 密: [-40, 40] */
+		xs[i] = -40.0 + 80.0 * i / (LEN - 1);
+	for (i = 0; i < LEN; i++)  ref[i] = expl(-0.5L * xs[i] * xs[i]) / SQRT2PI_L;
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = snormpdf(xs[i]);
+	report("snormpdf", "scalar", "dense[-40,40]", LEN, now_ns() - t, 0);
+
+	for (i = 0; i < LEN; i++)
+	{
+		z = ((long double)xs[i] - mu) / sigma;
+		ref[i] = expl(-0.5L * z * z) / (sigma * SQRT2PI_L);
+	}
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = normpdf(xs[i], mu, sigma);
+	report("normpdf", "scalar", "dense[-40,40]", LEN, now_ns() - t, 0);
+
+	for (i = 0; i < LEN; i++)  /* 乱: (0, 100] */
+		xs[i] = 100.0 * (1.0 - unif());
+	for (i = 0; i < LEN; i++)
+	{
+		z = (logl(xs[i]) - lmu) / lsigma;
+		ref[i] = expl(-0.5L * z * z) / (lsigma * xs[i] * SQRT2PI_L);
+	}
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = lognormpdf(xs[i], lmu, lsigma);
+	report("lognormpdf", "scalar", "random(0,100]", LEN, now_ns() - t, 0);
+}
+
+/*------------------------------------------------------------------------------
+	2項分布
+------------------------------------------------------------------------------*/
+static void
+bench_binompmf(void)
+{
+	enum { NX = 1024, NN = 32, NP = 32 };
+	static int gx[NX], gn[NN];
+	static double gp[NP];
+	static int bx[LEN], bn[LEN];
+	int i, ix, in, ip;
+	double t;
+
+	for (i = 0; i < LEN; i++)  /* 乱: $n \leq 10^{5}$ */
+	{
+		bn[i] = 1 + rand() % 100000;
+		ys[i] = unif();
+		bx[i] = (int)(bn[i] * ys[i] + sqrt(bn[i]) * (unif() - 0.5));
+		if (bx[i] < 0)  bx[i] = 0;
+		if (bx[i] > bn[i])  bx[i] = bn[i];
+	}
+	for (i = 0; i < LEN; i++)
+		ref[i] = expl(lgammal(bn[i] + 1.0L) - lgammal(bx[i] + 1.0L) - lgammal(bn[i] - bx[i] + 1.0L)
+		              + bx[i] * logl(ys[i]) + (bn[i] - bx[i]) * log1pl(-(long double)ys[i]));
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = binompmf(bx[i], bn[i], ys[i]);
+	report("binompmf", "scalar", "random", LEN, now_ns() - t, 0);
+
+	/* 格子: 配列版 */
+	for (i = 0; i < NX; i++)  gx[i] = i;
+	for (i = 0; i < NN; i++)  gn[i] = 1000 + 37 * i;
+	for (i = 0; i < NP; i++)  gp[i] = (i + 0.5) / NP;
+	for (ip = 0; ip < NP; ip++)
+		for (in = 0; in < NN; in++)
+			for (ix = 0; ix < NX; ix++)
+				ref[(ip * NN + in) * NX + ix] = ix > gn[in] ? 0 :
+				    expl(lgammal(gn[in] + 1.0L) - lgammal(ix + 1.0L) - lgammal(gn[in] - ix + 1.0L)
+				         + ix * logl(gp[ip]) + (gn[in] - ix) * log1pl(-(long double)gp[ip]));
+	t = now_ns();
+	binompmf_grid(NX, gx, NN, gn, NP, gp, out, 1);
+	report("binompmf", "grid/1thread", "grid", NX * NN * NP, now_ns() - t, 0);
+	t = now_ns();
+	binompmf_grid(NX, gx, NN, gn, NP, gp, out, 0);
+	report("binompmf", "grid/allthreads", "grid", NX * NN * NP, now_ns() - t, 0);
+}
+
+/*------------------------------------------------------------------------------
+	床・天井・切り捨て (参照はlibm，一致すべき)
+------------------------------------------------------------------------------*/
+static void
+bench_nnint_one(const char *name, double (*f)(double), double (*r)(double), const char *domain)
+{
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)  ref[i] = r(xs[i]);
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = f(xs[i]);
+	report(name, "scalar", domain, LEN, now_ns() - t, 0);
+}
+
+/* 配列版nnint_round_array()。参照はbench_nnint_one()と同じ */
+static void
+bench_nnint_array(const char *name, int mode, double (*r)(double), const char *domain)
+{
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)  ref[i] = r(xs[i]);
+	t = now_ns();
+	nnint_round_array(mode, LEN, xs, out);
+	report(name, "batch", domain, LEN, now_ns() - t, 0);
+}
+
+static void
+bench_nnint(void)
+{
+	int i;
+
+	for (i = 0; i < LEN; i++)  /* 密: [-1000, 1000] */
+		xs[i] = -1000.0 + 2000.0 * i / (LEN - 1);
+	bench_nnint_one("my_floor", my_floor, floor, "dense[-1e3,1e3]");
+	bench_nnint_one("my_ceil", my_ceil, ceil, "dense[-1e3,1e3]");
+	bench_nnint_one("my_trunc", my_trunc, trunc, "dense[-1e3,1e3]");
+	bench_nnint_array("nnint_round_array/floor", NNINT_FLOOR, floor, "dense[-1e3,1e3]");
+	bench_nnint_array("nnint_round_array/ceil", NNINT_CEIL, ceil, "dense[-1e3,1e3]");
+	bench_nnint_array("nnint_round_array/trunc", NNINT_TRUNC, trunc, "dense[-1e3,1e3]");
+	bench_nnint_array("nnint_round_array/round", NNINT_ROUND, round, "dense[-1e3,1e3]");
+	for (i = 0; i < LEN; i++)  /* 乱: $\pm 2^{-10}$から$2^{60}$ */
+		xs[i] = (rand() & 1 ? -1 : 1) * ldexp(1.0 + unif(), rand() % 70 - 10);
+	bench_nnint_one("my_floor", my_floor, floor, "random");
+	bench_nnint_one("my_ceil", my_ceil, ceil, "random");
+	bench_nnint_one("my_trunc", my_trunc, trunc, "random");
+	bench_nnint_array("nnint_round_array/floor", NNINT_FLOOR, floor, "random");
+	bench_nnint_array("nnint_round_array/ceil", NNINT_CEIL, ceil, "random");
+	bench_nnint_array("nnint_round_array/trunc", NNINT_TRUNC, trunc, "random");
+	bench_nnint_array("nnint_round_array/round", NNINT_ROUND, round, "random");
+}
+
+/*------------------------------------------------------------------------------
+	象限 (参照はatan2l)
+------------------------------------------------------------------------------*/
+static void
+bench_quadrant(void)
+{
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)  /* 密: 単位円周 */
+	{
+		xs[i] = cos(2 * PI * (i + 0.5) / LEN);
+		ys[i] = sin(2 * PI * (i + 0.5) / LEN);
+	}
+	for (i = 0; i < LEN; i++)  ref[i] = atan2l(ys[i], xs[i]);
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = quadrant(xs[i], ys[i]);
+	report("quadrant", "scalar", "dense(unit circle)", LEN, now_ns() - t, 0);
+	t = now_ns();
+	quadrant_batch(LEN, xs, ys, out);
+	report("quadrant", "batch", "dense(unit circle)", LEN, now_ns() - t, 0);
+
+	for (i = 0; i < LEN; i++)  /* 乱: 各成分$\pm 2^{-30}$から$2^{30}$ */
+	{
+		xs[i] = (rand() & 1 ? -1 : 1) * ldexp(1.0 + unif(), rand() % 60 - 30);
+		ys[i] = (rand() & 1 ? -1 : 1) * ldexp(1.0 + unif(), rand() % 60 - 30);
+	}
+	for (i = 0; i < LEN; i++)  ref[i] = atan2l(ys[i], xs[i]);
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  out[i] = quadrant(xs[i], ys[i]);
+	report("quadrant", "scalar", "random", LEN, now_ns() - t, 0);
+	t = now_ns();
+	quadrant_batch(LEN, xs, ys, out);
+	report("quadrant", "batch", "random", LEN, now_ns() - t, 0);
+}
+
+/*------------------------------------------------------------------------------
+	整数の指数の累乗 (参照はpowl，比較にpow)
+------------------------------------------------------------------------------*/
+static void
+bench_powi(void)
+{
+	static const int ns[] = { 5, 100 };
+	char domain[32];
+	double t;
+	int i, j;
+
+	for (i = 0; i < LEN; i++)  /* $\pm[0.5, 1.5)$ */
+		xs[i] = (rand() & 1 ? -1 : 1) * (0.5 + unif());
+	for (j = 0; j < 2; j++)
+	{
+		snprintf(domain, sizeof domain, "n=%d", ns[j]);
+		for (i = 0; i < LEN; i++)  ref[i] = powl(xs[i], ns[j]);
+		t = now_ns();
+		for (i = 0; i < LEN; i++)  out[i] = pow(xs[i], ns[j]);
+		report("pow", "libm", domain, LEN, now_ns() - t, 0);
+		t = now_ns();
+		for (i = 0; i < LEN; i++)  out[i] = powi(xs[i], ns[j]);
+		report("powi", "scalar", domain, LEN, now_ns() - t, 0);
+		t = now_ns();
+		powi_batch(LEN, xs, ns[j], out);
+		report("powi", "batch", domain, LEN, now_ns() - t, 0);
+	}
+}
+
+/*------------------------------------------------------------------------------
+	符号化 (参照は1標本ずつの符号化器を復号した値。配列版はこれと一致するはず)
+	配列版はpcmconvと同じCHUNK標本ずつ呼ぶ。1/9は範囲外なので，PROBE=1では
+	飽和の計数も通る
+------------------------------------------------------------------------------*/
+static void
+bench_codec_one(const char *name, void (*enc)(pio_broker_t *), void (*dec)(pio_broker_t *),
+                void (*enc_batch)(int, const double *, uint8_t *),
+                void (*dec_batch)(int, const uint8_t *, double *), int width)
+{
+	static uint8_t b[4 * LEN];
+	pio_broker_t bro;
+	double t;
+	int i;
+
+	for (i = 0; i < LEN; i++)
+	{
+		bro.s = xs[i];
+		enc(&bro);
+		dec(&bro);
+		ref[i] = bro.s;
+	}
+	t = now_ns();
+	for (i = 0; i < LEN; i++)  /* ブローカーはvolatileなので消えない */
+	{
+		bro.s = xs[i];
+		enc(&bro);
+	}
+	for (i = 0; i < LEN; i++)  out[i] = ref[i];
+	report(name, "scalar", "[-1.125,1.125)", LEN, now_ns() - t, 0);
+	memset(b, 0, sizeof b);
+	t = now_ns();
+	for (i = 0; i < LEN; i += CHUNK)
+		enc_batch(CHUNK, xs + i, b + (size_t)width * i);
+	t = now_ns() - t;
+	dec_batch(LEN, b, out);
+	report(name, "batch", "[-1.125,1.125)", LEN, t, 0);
+}
+
+static void
+bench_codec(void)
+{
+	int i;
+
+	for (i = 0; i < LEN; i++)
+		xs[i] = 2.25 * unif() - 1.125;
+	bench_codec_one("enc_pcm8bit", enc_pcm8bit, dec_pcm8bit, enc_pcm8bit_batch, dec_pcm8bit_batch, 1);
+	bench_codec_one("enc_pcm16bit", enc_pcm16bit, dec_pcm16bit, enc_pcm16bit_batch, dec_pcm16bit_batch, 2);
+	bench_codec_one("enc_pcm24bit", enc_pcm24bit, dec_pcm24bit, enc_pcm24bit_batch, dec_pcm24bit_batch, 3);
+	bench_codec_one("enc_pcm32bit", enc_pcm32bit, dec_pcm32bit, enc_pcm32bit_batch, dec_pcm32bit_batch, 4);
+	bench_codec_one("enc_pcmu", enc_pcmu, dec_pcmu, enc_pcmu_batch, dec_pcmu_batch, 1);
+	bench_codec_one("enc_pcma", enc_pcma, dec_pcma, enc_pcma_batch, dec_pcma_batch, 1);
+}
+
+int
+main(void)
+{
+	srand(20181);
+	printf("{\n  \"reference\": \"long double (%d-bit mantissa)\",\n  \"results\": [\n", LDBL_MANT_DIG);
+	bench_loggamma();
+	bench_normpdf();
+	bench_binompmf();
+	bench_nnint();
+	bench_quadrant();
+	bench_powi();
+	bench_codec();
+	printf("\n  ]");
+#ifdef ALGO_PROBE
+	{
+		probe_snapshot_t ps;
+
+		probe_snapshot(&ps);
+		printf(",\n  \"probes\": ");
+		probe_export_json(stdout, &ps);
+	}
+#endif
+	printf("\n}\n");
+	return 0;
+}
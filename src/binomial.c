@@ -1,114 +1,1229 @@
-/***********************************************************
-	binomial.c -- 2項分布
-***********************************************************/
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
-#include <float.h>
-#define N_MAX 1000
-#define ITERATOR_AN_END 1
-
-// インタフェース
-typedef struct BinomParam {
-	int k, n;
-	double p, q, s, t;
-	int status;
-} binom_param_t ;
-
-void binom_param_nu_set(binom_param_t *, int);
-void binom_param_phi_set(binom_param_t *, double);
-static double binom_logfact(double, double, int, int);
-double binompmf(int, int, double);
-void binom_enum_initialize(int, double, binom_param_t *);
-
-void
-error(char *s)
-{
-	printf("%s\n", s);
-	exit(1);
-}
-
-/* ベルヌーイ試行をセットする関数 */
-void
-binom_param_nu_set(binom_param_t *param, int n)
-{
-	if (n <= 0 || n > N_MAX)
-		error("nが小さいか大きすぎます");
-	param->n = n;
-}
-
-/* 成功率をセットする関数 */
-void
-binom_param_phi_set(binom_param_t *param, double p)
-{
-	if (p < 0 || p > 1)
-		error("pが百分率ではありません");
-	param->p = p;
-}
-
-/* 対数階乗による確率質量関数ルーチン */
-static double
-binom_logfact(double p, double q, int m, int n)
-{ 
-	register double temp = lgamma(m + n + 1.0);
-	temp -= lgamma(n + 1.0) + lgamma(m + 1.0);
-	temp += m * log(p) + n * log(q);
-	return exp(temp);
-}
-
-/* 確率質量関数ルーチン */
-double
-binompmf(int x, int n, double p)
-{
-	if (x < 0 || x > n)  return 0.0;
-	if (p < 0.0 || p > 1.0)  return NAN;
-	return binom_logfact(p, 1-p, x, n-x);
-}
-
-/* 二項分布のEnumerator */
-void
-binom_enum_initialize(int n, double p, binom_param_t *param)
-{
-	binom_param_nu_set(param, n);
-	binom_param_phi_set(param, p);
-	param->k = 0;
-	param->q = 1 - p;
-	param->s = param->t = pow(param->q, n);
-	if (param->s == 0) param->s = param->t = binompmf(0, n, p);	
-	if (param->s == 0) error("n か p が大きすぎます");
-	param->status = 0;
-}
-
-/* yield */
-void
-binom_each_yield(binom_param_t *param)
-{
-	if (param->k < param->n)
-	{
-		param->t *= (param->n - param->k) * param->p / ((param->k + 1) * param->q);
-		param->s += param->t;
-		if (param->s >= 1)  param->s = 0.5+0.5-DBL_EPSILON;
-		if (param->k == param->n - 1)  param->s = 1.0;
-		param->k++;
-	}
-	else
-		param->status = ITERATOR_AN_END;
-}
-
-int
-main(void)
-{
-	binom_param_t param;
-	int n;
-	double p;
-
-	printf("n, p? ");  scanf("%d%lf", &n, &p);
-	binom_enum_initialize(n, p, &param);
-	
-	puts(" (n) CDF               PMF");
-	while (param.status != ITERATOR_AN_END) {
-		printf("%4d %16.15f %16.15f\n", param.k, param.s, param.t);
-		binom_each_yield(&param);
-	}
-	return 0;
-}
+/***********************************************************
+	binomial.c -- 2項分布
+***********************************************************/
+#define _POSIX_C_SOURCE 200809L  /* pthread_rwlock_t */
+#define _DEFAULT_SOURCE          /* lgamma_r() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "algomath.h"  /* binom_param_t, binom_sampler_t など */
+#include "probe.h"  /* -DALGO_PROBEのときだけ数える */
+#define ITERATOR_AN_END 1
+#define BINOM_TOL (DBL_EPSILON * DBL_EPSILON)  /* 最頻値に対する打ち切り比 */
+#define LOGFACT_BOUND 1000000  /* 対数階乗表の既定の大きさ */
+
+/* (n, p)ごとの表: 累積確率・案内表・エイリアス表 */
+typedef struct BinomTable {
+	int n, lo, len;  /* k = lo, ..., lo + len - 1 */
+	double p;
+	double *cdf;
+	int *guide;      /* guide[j] = min{ i : cdf[i] >= j / len } */
+	double *prob;    /* エイリアス表 (Walker/Vose) */
+	int *alias;
+	atomic_ulong stamp;  /* LRU用の最終参照時刻 */
+} binom_table_t ;
+
+// インタフェース
+void binom_param_nu_set(binom_param_t *, int);
+void binom_param_phi_set(binom_param_t *, double);
+int logfact_set_bound(int);
+double logfact(int);
+double lchoose(int, int);
+static double binom_logpmf(double, double, int, int);
+static double binom_logfact(double, double, int, int);
+double binompmf(int, int, double);
+static double binom_betacf(double, double, double);
+static double binom_ibeta(double, double, double);
+double binomcdf(int, int, double);
+double binomsf(int, int, double);
+void binomcdf_batch(int, const int *, const int *, const double *, double *);
+void binomsf_batch(int, const int *, const int *, const double *, double *);
+static int binom_mode(int, double);
+void binom_enum_initialize(int, double, binom_param_t *);
+void binom_each_yield(binom_param_t *);
+int binom_fill(int, double, double *, double *, int, int);
+void binom_sampler_initialize(int, double, uint64_t, binom_sampler_t *);
+int binom_sample(binom_sampler_t *);
+void binom_sample_fill(binom_sampler_t *, int *, int);
+static binom_table_t *binom_table_new(int, double);
+static void binom_table_free(binom_table_t *);
+double binom_cache_cdf(int, int, double);
+int binom_cache_quantile(double, int, double);
+void binom_cache_sample_fill(int, double, const double *, int *, int);
+void binom_cache_stats(binom_cache_stats_t *);
+int binompmf_grid(int, const int *, int, const int *, int, const double *, double *, int);
+static double binom_gammq(double, double);
+static int binom_approx_method(int, double, double, double, double *);
+binom_approx_t binompmf_approx(int, int, double, double);
+binom_approx_t binomcdf_approx(int, int, double, double);
+
+static void
+error(char *s)
+{
+	printf("%s\n", s);
+	exit(1);
+}
+
+/* ベルヌーイ試行をセットする関数 */
+void
+binom_param_nu_set(binom_param_t *param, int n)
+{
+	if (n <= 0)
+		error("nが小さすぎます");
+	param->n = n;
+}
+
+/* 成功率をセットする関数 */
+void
+binom_param_phi_set(binom_param_t *param, double p)
+{
+	if (p < 0 || p > 1)
+		error("pが百分率ではありません");
+	param->p = p;
+}
+
+/* 対数階乗の表
+ * $\log k!$ ($0 \leq k <$ logfact_len)を初めて使うときに一度だけ作る。
+ * 表の公開はアトミックなポインタで行ない，作り終えた後の読み手はロックを
+ * 取らない。表より大きい引数と，表が作れなかった場合はlgamma_r()
+ * (Stirlingの漸近展開)に回る。
+ */
+static int logfact_want = LOGFACT_BOUND;
+static int logfact_len;
+static double logfact_none[1];  /* 表を持たないときに公開する空の表 */
+static _Atomic(double *) logfact_tab;
+static pthread_mutex_t logfact_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const double *
+logfact_table(void)
+{
+	double *t = atomic_load_explicit(&logfact_tab, memory_order_acquire);
+	int k, sg;
+
+	if (t != NULL)  return t;
+	pthread_mutex_lock(&logfact_lock);
+	t = atomic_load_explicit(&logfact_tab, memory_order_relaxed);
+	if (t == NULL)
+	{
+		if (logfact_want > 0 && (t = malloc(sizeof(double) * logfact_want)) != NULL)
+		{
+			for (k = 0; k < logfact_want; k++)
+				t[k] = lgamma_r(k + 1.0, &sg);
+			logfact_len = logfact_want;
+		}
+		else
+			t = logfact_none;  /* 以後は常にlgamma_r() */
+		atomic_store_explicit(&logfact_tab, t, memory_order_release);
+	}
+	pthread_mutex_unlock(&logfact_lock);
+	return t;
+}
+
+/* 表の大きさを変える。表を作る前にだけ効き，作った後なら-1を返す */
+int
+logfact_set_bound(int bound)
+{
+	int r = -1;
+
+	pthread_mutex_lock(&logfact_lock);
+	if (atomic_load_explicit(&logfact_tab, memory_order_relaxed) == NULL && bound >= 0)
+	{
+		logfact_want = bound;
+		r = 0;
+	}
+	pthread_mutex_unlock(&logfact_lock);
+	return r;
+}
+
+/* $\log k!$ */
+double
+logfact(int k)
+{
+	const double *t;
+	int sg;
+
+	if (k < 0)  return NAN;
+	t = logfact_table();
+	if (k < logfact_len)
+		return t[k];
+	PROBE_COUNT(PROBE_LOGFACT_LGAMMA, 1);
+	return lgamma_r(k + 1.0, &sg);
+}
+
+/* 二項係数の対数 $\log\binom{n}{k}$ */
+double
+lchoose(int n, int k)
+{
+	if (k < 0 || k > n)  return -HUGE_VAL;
+	return logfact(n) - logfact(k) - logfact(n - k);
+}
+
+/* 確率質量関数の対数 */
+static double
+binom_logpmf(double p, double q, int m, int n)
+{
+	return lchoose(m + n, m) + m * log(p) + n * log(q);
+}
+
+/* 対数階乗による確率質量関数ルーチン */
+static double
+binom_logfact(double p, double q, int m, int n)
+{ 
+	return exp(binom_logpmf(p, q, m, n));
+}
+
+/* 確率質量関数ルーチン */
+double
+binompmf(int x, int n, double p)
+{
+	if (x < 0 || x > n)  return 0.0;
+	if (p < 0.0 || p > 1.0)  return NAN;
+	return binom_logfact(p, 1-p, x, n-x);
+}
+
+/* 不完全ベータ関数の連分数 (修正Lentz法)
+ * $x < (a+1)/(a+b+2)$の側で使えば，収束に要する反復は$O(\sqrt{\max(a, b)})$
+ * (分布の標準偏差の桁)で，kについての和は取らない。定数時間ではないが，
+ * $n = 10^{9}$でも数千回で済む。上限までに収束しなければNaNを返す。
+ */
+static double
+binom_betacf(double a, double b, double x)
+{
+	const double fpmin = DBL_MIN / DBL_EPSILON;
+	double c, d, h, aa, del;
+	int m, m2, itmax;
+
+	itmax = 100 + (int)(10 * sqrt(a > b ? a : b));
+	c = 1.0;
+	d = 1.0 - (a + b) * x / (a + 1.0);
+	if (fabs(d) < fpmin)  d = fpmin;
+	d = 1.0 / d;
+	h = d;
+	for (m = 1; m <= itmax; m++)
+	{
+		m2 = 2 * m;
+		/* 偶数項 */
+		aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+		d = 1.0 + aa * d;  if (fabs(d) < fpmin)  d = fpmin;
+		c = 1.0 + aa / c;  if (fabs(c) < fpmin)  c = fpmin;
+		d = 1.0 / d;
+		h *= d * c;
+		/* 奇数項 */
+		aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+		d = 1.0 + aa * d;  if (fabs(d) < fpmin)  d = fpmin;
+		c = 1.0 + aa / c;  if (fabs(c) < fpmin)  c = fpmin;
+		d = 1.0 / d;
+		del = d * c;
+		h *= del;
+		if (fabs(del - 1.0) < DBL_EPSILON)  return h;
+	}
+	return NAN;  /* 収束しなかった */
+}
+
+/* 正則化不完全ベータ関数 $I_{x}(a, b)$ */
+static double
+binom_ibeta(double a, double b, double x)
+{
+	double front;
+
+	if (x <= 0)  return 0.0;
+	if (x >= 1)  return 1.0;
+	front = exp(lgamma(a + b) - lgamma(a) - lgamma(b)
+	            + a * log(x) + b * log1p(-x));
+	if (x < (a + 1.0) / (a + b + 2.0))
+		return front * binom_betacf(a, b, x) / a;
+	return 1.0 - front * binom_betacf(b, a, 1.0 - x) / b;
+}
+
+/* 累積分布関数 $P(X \leq k) = I_{1-p}(n-k, k+1)$ */
+double
+binomcdf(int k, int n, double p)
+{
+	if (p < 0.0 || p > 1.0 || p != p)  return NAN;
+	if (k < 0)  return 0.0;
+	if (k >= n)  return 1.0;
+	return binom_ibeta(n - k, k + 1.0, 1.0 - p);
+}
+
+/* 生存関数 $P(X > k) = I_{p}(k+1, n-k)$ */
+double
+binomsf(int k, int n, double p)
+{
+	if (p < 0.0 || p > 1.0 || p != p)  return NAN;
+	if (k < 0)  return 1.0;
+	if (k >= n)  return 0.0;
+	return binom_ibeta(k + 1.0, n - k, p);
+}
+
+/* (k, n, p)の組を一括で評価する */
+void
+binomcdf_batch(int len, const int *k, const int *n, const double *p, double *cdf)
+{
+	for (int i = 0; i < len; i++)
+		cdf[i] = binomcdf(k[i], n[i], p[i]);
+}
+
+void
+binomsf_batch(int len, const int *k, const int *n, const double *p, double *sf)
+{
+	for (int i = 0; i < len; i++)
+		sf[i] = binomsf(k[i], n[i], p[i]);
+}
+
+/* 最頻値 $\lfloor (n+1)p \rfloor$ */
+static int
+binom_mode(int n, double p)
+{
+	double m = floor((n + 1.0) * p);
+
+	return m > n ? n : (int)m;
+}
+
+/* 二項分布のEnumerator
+ * 最頻値mから両側へ漸化式で項を辿る。項は最頻値を1とした相対値で
+ * 持つので下位桁があふれることはなく，相対値がBINOM_TOLを下回った所を
+ * 列挙の範囲[lo, hi]とする。最頻値のPMFは対数階乗でも求まるが，nが
+ * 大きいとlgammaの桁落ちで総和が1に届かないので，相対値の総和wで
+ * 正規化し直す。手間は$O(\sqrt{npq})$で，nの上限はない。
+ */
+void
+binom_enum_initialize(int n, double p, binom_param_t *param)
+{
+	register double r, t, w;
+	register int m, k;
+	PROBE_TIMER_START(t0, PROBE_T_BINOM_ENUM);
+
+	PROBE_COUNT(PROBE_BINOM_ENUM, 1);
+	binom_param_nu_set(param, n);
+	binom_param_phi_set(param, p);
+	param->q = 1 - p;
+	param->status = 0;
+	if (p == 0 || p == 1)  /* 一点分布 */
+	{
+		param->k = param->lo = param->hi = (p == 0 ? 0 : n);
+		param->s = param->t = 1.0;
+		return;
+	}
+	m = binom_mode(n, p);
+	/* 下側: $t_{k-1} = t_{k}\cdot kq/((n-k+1)p)$ */
+	r = w = 1.0;
+	for (k = m; k > 0; k--)
+	{
+		t = r * k * param->q / ((double)(n - k + 1) * p);
+		if (t < BINOM_TOL)  break;
+		w += r = t;
+	}
+	param->lo = k;
+	/* 上側: $t_{k+1} = t_{k}\cdot (n-k)p/((k+1)q)$ */
+	t = 1.0;
+	for (k = m; k < n; k++)
+	{
+		t *= (double)(n - k) * p / ((k + 1.0) * param->q);
+		if (t < BINOM_TOL)  break;
+		w += t;
+	}
+	param->hi = k;
+	param->k = param->lo;
+	param->s = param->t = r / w;
+	PROBE_COUNT(PROBE_BINOM_ENUM_TERMS, param->hi - param->lo + 1);
+	PROBE_TIMER_STOP(t0, PROBE_T_BINOM_ENUM);
+}
+
+/* yield */
+void
+binom_each_yield(binom_param_t *param)
+{
+	if (param->k < param->hi)
+	{
+		param->t *= (param->n - param->k) * param->p / ((param->k + 1) * param->q);
+		param->s += param->t;
+		if (param->s >= 1)  param->s = 0.5+0.5-DBL_EPSILON;
+		if (param->k == param->hi - 1)  param->s = 1.0;
+		param->k++;
+	}
+	else
+		param->status = ITERATOR_AN_END;
+}
+
+/* PMF/CDFの表を一括で埋める
+ * pmf[0..k1-k0], cdf[0..k1-k0]に$k = k_{0},\ldots,k_{1}$の値を書く。
+ * pmfかcdfにNULLを渡せば，その側は書かない(CDFだけの表を作れる)。
+ * yieldの分岐は列挙範囲[lo, hi]の外側と後始末に追い出してあり，
+ * 内側のループは漸化式と格納だけになる。
+ * 戻り値は0で成功，-1で引数の誤り(n, p, kの範囲)。誤りなら何も書かない。
+ */
+int
+binom_fill(int n, double p, double *pmf, double *cdf, int k0, int k1)
+{
+	binom_param_t param;
+	register double t, s, pq;
+	register int k, a, b;
+
+	if (n <= 0 || !(p >= 0 && p <= 1) || k0 < 0 || k1 > n || k0 > k1)
+		return -1;
+	binom_enum_initialize(n, p, &param);
+	t = param.t;  s = param.s;
+	pq = p / param.q;
+	a = k0 > param.lo ? k0 : param.lo;
+	b = k1 < param.hi ? k1 : param.hi;
+	/* 範囲より下は0 */
+	for (k = k0; k < a && k <= k1; k++)
+	{
+		if (pmf != NULL)  pmf[k - k0] = 0.0;
+		if (cdf != NULL)  cdf[k - k0] = 0.0;
+	}
+	/* 書き出し開始点まで進める。範囲[lo, hi]と交わらなければ歩かない */
+	for (k = param.lo; k < a && a <= b; k++)
+	{
+		t *= (n - k) * pq / (k + 1);
+		s += t;
+	}
+	if (pmf != NULL && cdf != NULL)
+		for (k = a; k <= b; k++)
+		{
+			pmf[k - k0] = t;
+			cdf[k - k0] = s;
+			t *= (n - k) * pq / (k + 1);
+			s += t;
+		}
+	else if (cdf != NULL)
+		for (k = a; k <= b; k++)
+		{
+			cdf[k - k0] = s;
+			t *= (n - k) * pq / (k + 1);
+			s += t;
+		}
+	else if (pmf != NULL)
+		for (k = a; k <= b; k++)
+		{
+			pmf[k - k0] = t;
+			t *= (n - k) * pq / (k + 1);
+		}
+	/* 範囲より上は0と1 */
+	for (k = b + 1 > k0 ? b + 1 : k0; k <= k1; k++)
+	{
+		if (pmf != NULL)  pmf[k - k0] = 0.0;
+		if (cdf != NULL)  cdf[k - k0] = 1.0;
+	}
+	/* yieldと同じ後始末: 末尾の前で1に達した累積確率を丸め戻す */
+	if (cdf != NULL && a <= b)
+	{
+		for (k = b < param.hi ? b : param.hi - 1; k >= a && cdf[k - k0] >= 1; k--)
+			cdf[k - k0] = 0.5+0.5-DBL_EPSILON;
+		if (b == param.hi)  cdf[b - k0] = 1.0;
+	}
+	return 0;
+}
+
+/* 一様乱数 (0, 1) -- xorshift64* */
+static inline double
+binom_unif(binom_sampler_t *smp)
+{
+	uint64_t x = smp->state;
+
+	x ^= x >> 12;  x ^= x << 25;  x ^= x >> 27;
+	smp->state = x;
+	return ((x * UINT64_C(0x2545F4914F6CDD1D) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/* 乱数生成器のセットアップ
+ * $n\min(p, q) < 30$なら逆関数法，それ以上ならBTPE (Kachitvichyanukul &
+ * Schmeiser, 1988)を使う。定数はここで一度だけ求めておく。
+ */
+void
+binom_sampler_initialize(int n, double p, uint64_t seed, binom_sampler_t *smp)
+{
+	binom_param_t param;
+	double fm, a;
+
+	binom_param_nu_set(&param, n);
+	binom_param_phi_set(&param, p);
+	smp->n = n;
+	smp->swap = p > 0.5;
+	smp->r = smp->swap ? 1 - p : p;
+	smp->q = 1 - smp->r;
+	smp->state = seed ? seed : UINT64_C(0x9E3779B97F4A7C15);
+	smp->btpe = n * smp->r >= 30;
+	if (!smp->btpe)
+	{
+		smp->qn = powi(smp->q, n);  /* 補償つきの二進法(power.c)。exp(n * log(q))より正確 */
+		smp->bound = n * smp->r + 10.0 * sqrt(n * smp->r * smp->q + 1);
+		if (smp->bound > n)  smp->bound = n;
+		return;
+	}
+	smp->nrq = n * smp->r * smp->q;
+	fm = n * smp->r + smp->r;
+	smp->m = (int)floor(fm);
+	smp->p1 = floor(2.195 * sqrt(smp->nrq) - 4.6 * smp->q) + 0.5;
+	smp->xm = smp->m + 0.5;
+	smp->xl = smp->xm - smp->p1;
+	smp->xr = smp->xm + smp->p1;
+	smp->c = 0.134 + 20.5 / (15.3 + smp->m);
+	a = (fm - smp->xl) / (fm - smp->xl * smp->r);
+	smp->laml = a * (1.0 + a / 2.0);
+	a = (smp->xr - fm) / (smp->xr * smp->q);
+	smp->lamr = a * (1.0 + a / 2.0);
+	smp->p2 = smp->p1 * (1.0 + 2.0 * smp->c);
+	smp->p3 = smp->p2 + smp->c / smp->laml;
+	smp->p4 = smp->p3 + smp->c / smp->lamr;
+	smp->lfm = binom_logpmf(smp->r, smp->q, smp->m, n - smp->m);
+}
+
+/* 逆関数法: 0から順にPMFを引いていく */
+static int
+binom_sample_inversion(binom_sampler_t *smp)
+{
+	register double u, px;
+	register int x;
+
+	x = 0;  px = smp->qn;
+	u = binom_unif(smp);
+	while (u > px)
+	{
+		x++;
+		if (x > smp->bound)
+		{
+			x = 0;  px = smp->qn;
+			u = binom_unif(smp);
+		}
+		else
+		{
+			u -= px;
+			px = ((smp->n - x + 1) * smp->r * px) / (x * smp->q);
+		}
+	}
+	return x;
+}
+
+/* BTPE: 三角形・平行四辺形・指数裾による棄却法 */
+static int
+binom_sample_btpe(binom_sampler_t *smp)
+{
+	double u, v, x, f, s, a, rho, t, lv;
+	int y, k, i;
+
+	for (;;)
+	{
+		u = binom_unif(smp) * smp->p4;
+		v = binom_unif(smp);
+		if (u <= smp->p1)  /* 三角形の部分はそのまま受理 */
+			return (int)floor(smp->xm - smp->p1 * v + u);
+		if (u <= smp->p2)  /* 平行四辺形 */
+		{
+			x = smp->xl + (u - smp->p1) / smp->c;
+			v = v * smp->c + 1.0 - fabs(smp->m - x + 0.5) / smp->p1;
+			if (v > 1.0)  continue;
+			y = (int)floor(x);
+		}
+		else if (u <= smp->p3)  /* 左の指数裾 */
+		{
+			y = (int)floor(smp->xl + log(v) / smp->laml);
+			if (y < 0 || v == 0.0)  continue;
+			v *= (u - smp->p2) * smp->laml;
+		}
+		else  /* 右の指数裾 */
+		{
+			x = floor(smp->xr - log(v) / smp->lamr);
+			if (x > smp->n || v == 0.0)  continue;
+			y = (int)x;
+			v *= (u - smp->p3) * smp->lamr;
+		}
+		k = abs(y - smp->m);
+		if (k <= 20 || k >= smp->nrq / 2.0 - 1)
+		{
+			/* 最頻値からの漸化式で$f(y)/f(m)$を求めて比べる */
+			s = smp->r / smp->q;  a = s * (smp->n + 1);  f = 1.0;
+			if (smp->m < y)
+				for (i = smp->m + 1; i <= y; i++)  f *= (a / i - s);
+			else
+				for (i = y + 1; i <= smp->m; i++)  f /= (a / i - s);
+			if (v <= f)  return y;
+			continue;
+		}
+		/* 正規近似によるsqueeze */
+		rho = (k / smp->nrq) * ((k * (k / 3.0 + 0.625) + 0.16666666666666666) / smp->nrq + 0.5);
+		t = -(double)k * k / (2 * smp->nrq);
+		lv = log(v);
+		if (lv < t - rho)  return y;
+		if (lv > t + rho)  continue;
+		/* 最後は対数階乗で正確に判定する */
+		if (lv <= binom_logpmf(smp->r, smp->q, y, smp->n - y) - smp->lfm)
+			return y;
+	}
+}
+
+/* 二項乱数を1つ引く */
+int
+binom_sample(binom_sampler_t *smp)
+{
+	int x = smp->btpe ? binom_sample_btpe(smp) : binom_sample_inversion(smp);
+
+	return smp->swap ? smp->n - x : x;
+}
+
+/* 二項乱数で配列を埋める */
+void
+binom_sample_fill(binom_sampler_t *smp, int *x, int len)
+{
+	int i;
+
+	if (smp->btpe)
+		for (i = 0; i < len; i++)  x[i] = binom_sample_btpe(smp);
+	else
+		for (i = 0; i < len; i++)  x[i] = binom_sample_inversion(smp);
+	if (smp->swap)
+		for (i = 0; i < len; i++)  x[i] = smp->n - x[i];
+}
+
+/* 表を作る
+ * 範囲[lo, hi]をbinom_fill()で埋め，案内表とエイリアス表を組む。
+ * ライブラリの中なのでerror()で止めず，メモリが足りなければNULLを返す。
+ * n, pの検査はbinom_cache_acquire()で済ませてある。
+ */
+static binom_table_t *
+binom_table_new(int n, double p)
+{
+	binom_param_t param;
+	binom_table_t *tab;
+	double *pmf;
+	int *small, *large;
+	int i, j, ns, nl, len;
+
+	binom_enum_initialize(n, p, &param);
+	len = param.hi - param.lo + 1;
+	if ((tab = calloc(1, sizeof(binom_table_t))) == NULL)
+		return NULL;
+	pmf = malloc(sizeof(double) * len);
+	small = malloc(sizeof(int) * 2 * len);
+	tab->cdf = malloc(sizeof(double) * len);
+	tab->guide = malloc(sizeof(int) * len);
+	tab->prob = malloc(sizeof(double) * len);
+	tab->alias = malloc(sizeof(int) * len);
+	if (pmf == NULL || small == NULL || tab->cdf == NULL || tab->guide == NULL ||
+	    tab->prob == NULL || tab->alias == NULL)
+	{
+		free(small);  free(pmf);
+		binom_table_free(tab);
+		return NULL;
+	}
+	large = small + len;
+	tab->n = n;  tab->p = p;
+	tab->lo = param.lo;  tab->len = len;
+	atomic_init(&tab->stamp, 0);
+	binom_fill(n, p, pmf, tab->cdf, param.lo, param.hi);
+
+	/* 案内表 (Chen & Asau) */
+	for (i = j = 0; j < len; j++)
+	{
+		while (i < len - 1 && tab->cdf[i] < (double)j / len)  i++;
+		tab->guide[j] = i;
+	}
+
+	/* エイリアス表 (Vose) */
+	ns = nl = 0;
+	for (i = 0; i < len; i++)
+	{
+		tab->prob[i] = pmf[i] * len;
+		tab->alias[i] = i;
+		if (tab->prob[i] < 1.0)  small[ns++] = i;
+		else                     large[nl++] = i;
+	}
+	while (ns > 0 && nl > 0)
+	{
+		int l = small[--ns], g = large[--nl];
+
+		tab->alias[l] = g;
+		tab->prob[g] = (tab->prob[g] + tab->prob[l]) - 1.0;
+		if (tab->prob[g] < 1.0)  small[ns++] = g;
+		else                     large[nl++] = g;
+	}
+	while (nl > 0)  tab->prob[large[--nl]] = 1.0;
+	while (ns > 0)  tab->prob[small[--ns]] = 1.0;  /* 丸め誤差の残り */
+
+	free(small);
+	free(pmf);
+	return tab;
+}
+
+static void
+binom_table_free(binom_table_t *tab)
+{
+	if (tab == NULL)  return;
+	free(tab->cdf);  free(tab->guide);
+	free(tab->prob);  free(tab->alias);
+	free(tab);
+}
+
+/* (n, p)をキーとする有界LRUキャッシュ
+ * 全体を一本のロックで守らず，ハッシュでBINOM_CACHE_SHARDS個に分けた
+ * 読み書きロックで守る。読み手は共有ロックだけを取り，最終参照時刻は
+ * アトミックに書くので，同じ(n, p)を読む者同士は互いを待たない。
+ */
+#define BINOM_CACHE_SHARDS 16
+#define BINOM_CACHE_WAYS   16  /* 1シャードあたりの表の数 */
+
+static struct {
+	pthread_rwlock_t lock;
+	binom_table_t *way[BINOM_CACHE_WAYS];
+} binom_cache[BINOM_CACHE_SHARDS] = {
+#define BINOM_CACHE_SHARD_INIT  { PTHREAD_RWLOCK_INITIALIZER, { NULL } }
+	BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT,
+	BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT,
+	BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT,
+	BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT, BINOM_CACHE_SHARD_INIT
+#undef BINOM_CACHE_SHARD_INIT
+};
+static atomic_ulong binom_cache_clock;
+static atomic_ulong binom_cache_hits, binom_cache_misses, binom_cache_evictions;
+
+static unsigned
+binom_cache_hash(int n, double p)
+{
+	uint64_t h;
+
+	memcpy(&h, &p, sizeof h);
+	h ^= (uint64_t)(unsigned)n * UINT64_C(0x9E3779B97F4A7C15);
+	h ^= h >> 29;  h *= UINT64_C(0xBF58476D1CE4E5B9);  h ^= h >> 32;
+	return (unsigned)(h % BINOM_CACHE_SHARDS);
+}
+
+static binom_table_t *
+binom_cache_lookup(int sh, int n, double p)
+{
+	for (int i = 0; i < BINOM_CACHE_WAYS; i++)
+	{
+		binom_table_t *tab = binom_cache[sh].way[i];
+
+		if (tab != NULL && tab->n == n && tab->p == p)
+			return tab;
+	}
+	return NULL;
+}
+
+/* 表を引く。戻ったときシャードは共有ロックされているので，使い終えたら
+ * binom_cache_release()で外す。n, pが範囲外(NaNを含む)か表を作れなければ
+ * ロックせずにNULLを返す。binom_enum_initialize()のerror()に届く前に弾く。 */
+static binom_table_t *
+binom_cache_acquire(int n, double p, int *shp)
+{
+	binom_table_t *tab, *made;
+	int sh, i, victim;
+
+	if (n <= 0 || !(p >= 0 && p <= 1))  /* pがNaNでも偽 */
+		return NULL;
+	sh = binom_cache_hash(n, p);
+	pthread_rwlock_rdlock(&binom_cache[sh].lock);
+	tab = binom_cache_lookup(sh, n, p);
+	if (tab != NULL)
+		atomic_fetch_add_explicit(&binom_cache_hits, 1, memory_order_relaxed);
+	while (tab == NULL)
+	{
+		pthread_rwlock_unlock(&binom_cache[sh].lock);
+		atomic_fetch_add_explicit(&binom_cache_misses, 1, memory_order_relaxed);
+		if ((made = binom_table_new(n, p)) == NULL)  /* ロックの外で作る */
+			return NULL;
+		pthread_rwlock_wrlock(&binom_cache[sh].lock);
+		if (binom_cache_lookup(sh, n, p) == NULL)
+		{
+			victim = 0;
+			for (i = 0; i < BINOM_CACHE_WAYS; i++)
+			{
+				binom_table_t *t = binom_cache[sh].way[i];
+
+				if (t == NULL)  {  victim = i;  break;  }
+				if (atomic_load_explicit(&t->stamp, memory_order_relaxed) <
+				    atomic_load_explicit(&binom_cache[sh].way[victim]->stamp, memory_order_relaxed))
+					victim = i;
+			}
+			if (binom_cache[sh].way[victim] != NULL)
+				atomic_fetch_add_explicit(&binom_cache_evictions, 1, memory_order_relaxed);
+			binom_table_free(binom_cache[sh].way[victim]);
+			binom_cache[sh].way[victim] = made;
+		}
+		else
+			binom_table_free(made);  /* 他のスレッドが先に入れた */
+		pthread_rwlock_unlock(&binom_cache[sh].lock);
+		pthread_rwlock_rdlock(&binom_cache[sh].lock);
+		tab = binom_cache_lookup(sh, n, p);
+	}
+	atomic_store_explicit(&tab->stamp,
+	    atomic_fetch_add_explicit(&binom_cache_clock, 1, memory_order_relaxed) + 1,
+	    memory_order_relaxed);
+	*shp = sh;
+	return tab;
+}
+
+static void
+binom_cache_release(int sh)
+{
+	pthread_rwlock_unlock(&binom_cache[sh].lock);
+}
+
+/* 表の中での分位点: 案内表から始めて高々数歩。$0 \leq u \leq 1$であること */
+static inline int
+binom_table_quantile(const binom_table_t *tab, double u)
+{
+	int j = (int)(u * tab->len);
+	int i;
+
+	if (j >= tab->len)  j = tab->len - 1;
+	for (i = tab->guide[j]; i < tab->len - 1 && tab->cdf[i] < u; i++)
+		;
+	return tab->lo + i;
+}
+
+/* キャッシュした表による累積分布関数 */
+double
+binom_cache_cdf(int k, int n, double p)
+{
+	binom_table_t *tab;
+	double v;
+	int sh;
+
+	if ((tab = binom_cache_acquire(n, p, &sh)) == NULL)
+		return NAN;
+	if (k < tab->lo)                  v = 0.0;
+	else if (k >= tab->lo + tab->len) v = 1.0;
+	else                              v = tab->cdf[k - tab->lo];
+	binom_cache_release(sh);
+	return v;
+}
+
+/* 分位点 $\min\{k : F(k) \geq u\}$
+ * uが$[0, 1]$の外かNaN，または表を作れなければ-1を返す。
+ */
+int
+binom_cache_quantile(double u, int n, double p)
+{
+	binom_table_t *tab;
+	int k, sh;
+
+	if (!(u >= 0.0 && u <= 1.0))
+		return -1;
+	if ((tab = binom_cache_acquire(n, p, &sh)) == NULL)
+		return -1;
+	k = binom_table_quantile(tab, u);
+	binom_cache_release(sh);
+	return k;
+}
+
+/* エイリアス法で一様乱数u[]を二項乱数x[]に変える (1個あたりO(1))
+ * u[i]が$[0, 1]$の外かNaNならx[i] = -1。表を作れなければ全部-1。
+ */
+void
+binom_cache_sample_fill(int n, double p, const double *u, int *x, int len)
+{
+	binom_table_t *tab;
+	double v;
+	int i, j, sh;
+
+	if ((tab = binom_cache_acquire(n, p, &sh)) == NULL)
+	{
+		for (i = 0; i < len; i++)  x[i] = -1;
+		return;
+	}
+	for (i = 0; i < len; i++)
+	{
+		if (!(u[i] >= 0.0 && u[i] <= 1.0))
+		{
+			x[i] = -1;
+			continue;
+		}
+		v = u[i] * tab->len;
+		j = (int)v;
+		if (j >= tab->len)  j = tab->len - 1;
+		x[i] = tab->lo + (v - j < tab->prob[j] ? j : tab->alias[j]);
+	}
+	binom_cache_release(sh);
+}
+
+/* ヒット率のカウンタ */
+void
+binom_cache_stats(binom_cache_stats_t *st)
+{
+	st->hits = atomic_load(&binom_cache_hits);
+	st->misses = atomic_load(&binom_cache_misses);
+	st->evictions = atomic_load(&binom_cache_evictions);
+}
+
+/* 格子上の確率質量関数
+ * out[(ip * nn + in) * nx + ix] = binompmf(x[ix], n[in], p[ip])
+ * $\log p$, $\log q$はpごとに，$\log n!$はnごとに，$\log x!$はxごとに一度だけ
+ * 求めておき，1点あたりは$\log(n-x)!$の表引き1回にする。行(p, n)を
+ * スレッドに動的に配る。ワーカーからerror()は呼ばず，logfact()も
+ * signgamを書かないので再入可能である。
+ * 戻り値は0で成功，-1で引数の誤りかメモリ不足。
+ */
+typedef struct BinomGridTask {
+	int nx, nn, rows, chunk;
+	const int *x, *n;
+	const double *p;
+	const double *lx, *ln, *lp, *lq;  /* $\log x!$, $\log n!$, $\log p$, $\log q$ */
+	double *out;
+	atomic_int next;
+} binom_grid_task_t ;
+
+static void *
+binompmf_grid_worker(void *arg)
+{
+	binom_grid_task_t *task = arg;
+	int r, r1, ix, ip, in;
+
+	while ((r = atomic_fetch_add_explicit(&task->next, task->chunk, memory_order_relaxed)) < task->rows)
+	{
+		r1 = r + task->chunk < task->rows ? r + task->chunk : task->rows;
+		for (; r < r1; r++)
+		{
+			const double p = task->p[ip = r / task->nn];
+			const int n = task->n[in = r % task->nn];
+			const double lp = task->lp[ip], lq = task->lq[ip], ln = task->ln[in];
+			double *out = task->out + (size_t)r * task->nx;
+
+			if (p < 0.0 || p > 1.0 || p != p || n < 0)
+			{
+				for (ix = 0; ix < task->nx; ix++)  out[ix] = NAN;
+				continue;
+			}
+			if (p == 0 || p == 1)  /* 一点分布 */
+			{
+				for (ix = 0; ix < task->nx; ix++)
+					out[ix] = task->x[ix] == (p == 0 ? 0 : n) ? 1.0 : 0.0;
+				continue;
+			}
+			for (ix = 0; ix < task->nx; ix++)
+			{
+				const int x = task->x[ix];
+
+				if (x < 0 || x > n)
+					out[ix] = 0.0;
+				else
+					out[ix] = exp(ln - task->lx[ix] - logfact(n - x)
+					              + x * lp + (n - x) * lq);
+			}
+		}
+	}
+	return NULL;
+}
+
+int
+binompmf_grid(int nx, const int *x, int nn, const int *n, int np, const double *p,
+              double *out, int nthreads)
+{
+	binom_grid_task_t task;
+	pthread_t *th;
+	double *work;
+	int i, started;
+
+	if (nx < 0 || nn < 0 || np < 0 || (nx && x == NULL) || (nn && n == NULL)
+	    || (np && p == NULL) || out == NULL)
+		return -1;
+	if ((long long)nn * np > INT32_MAX)
+		return -1;
+	if (nx == 0 || nn == 0 || np == 0)
+		return 0;
+	work = malloc(sizeof(double) * (nx + nn + 2 * (size_t)np));
+	if (work == NULL)
+		return -1;
+	task.lx = work;  task.ln = work + nx;
+	task.lp = work + nx + nn;  task.lq = work + nx + nn + np;
+	for (i = 0; i < nx; i++)
+		work[i] = x[i] >= 0 ? logfact(x[i]) : 0.0;
+	for (i = 0; i < nn; i++)
+		work[nx + i] = n[i] >= 0 ? logfact(n[i]) : 0.0;
+	for (i = 0; i < np; i++)
+	{
+		work[nx + nn + i] = log(p[i]);
+		work[nx + nn + np + i] = log1p(-p[i]);
+	}
+	task.nx = nx;  task.nn = nn;  task.rows = nn * np;
+	task.x = x;  task.n = n;  task.p = p;  task.out = out;
+	task.chunk = 1 + 4096 / nx;  /* 1回に配る行数: 4096点ほど */
+	atomic_init(&task.next, 0);
+
+	if (nthreads <= 0)
+		nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > task.rows)
+		nthreads = task.rows;
+	th = nthreads > 1 ? malloc(sizeof(pthread_t) * (nthreads - 1)) : NULL;
+	started = 0;
+	if (th != NULL)
+		for (; started < nthreads - 1; started++)
+			if (pthread_create(&th[started], NULL, binompmf_grid_worker, &task) != 0)
+				break;  /* 作れなかった分は呼び出し側のスレッドが受け持つ */
+	binompmf_grid_worker(&task);
+	for (i = 0; i < started; i++)
+		pthread_join(th[i], NULL);
+	free(th);
+	free(work);
+	return 0;
+}
+
+/* 近似エンジン
+ * 許容誤差tolを満たす最も安い方法を選ぶ。誤差の上界は次のとおり。
+ * Poisson ($\lambda = n\min(p, q)$): 全変動距離が$(1 - e^{-\lambda})\min(p, q)$
+ *   以下 (Barbour & Hall, 1984)。PMFにもCDFにもそのまま効く。
+ * 正規 (連続修正つき): CDFはBerry-Esseenで$0.4748(p^2+q^2)/\sqrt{npq}$以下
+ *   (Shevtsova, 2011)。PMFは$\Phi$の差で求めるのでその2倍。
+ * どちらも満たさなければ厳密値(binompmf, binomcdf)を返し，上界は0とする。
+ */
+#define BINOM_BERRY_ESSEEN 0.4748
+
+/* 正則化上側不完全ガンマ関数 $Q(a, x)$ -- PoissonのCDFに使う */
+static double
+binom_gammq(double a, double x)
+{
+	const double fpmin = DBL_MIN / DBL_EPSILON;
+	double ap, sum, del, b, c, d, h, an, front;
+	int i, itmax;
+
+	if (x <= 0)  return 1.0;
+	front = exp(-x + a * log(x) - lgamma(a));
+	itmax = 100 + (int)(10 * sqrt(a > x ? a : x));
+	if (x < a + 1.0)  /* 級数 */
+	{
+		ap = a;  sum = del = 1.0 / a;
+		for (i = 1; i <= itmax; i++)
+		{
+			del *= x / ++ap;
+			sum += del;
+			if (fabs(del) < fabs(sum) * DBL_EPSILON)  break;
+		}
+		return 1.0 - sum * front;
+	}
+	/* 連分数 (修正Lentz法) */
+	b = x + 1.0 - a;  c = 1.0 / fpmin;  d = 1.0 / b;  h = d;
+	for (i = 1; i <= itmax; i++)
+	{
+		an = -i * (i - a);
+		b += 2.0;
+		d = an * d + b;  if (fabs(d) < fpmin)  d = fpmin;
+		c = b + an / c;  if (fabs(c) < fpmin)  c = fpmin;
+		d = 1.0 / d;
+		del = d * c;
+		h *= del;
+		if (fabs(del - 1.0) < DBL_EPSILON)  break;
+	}
+	return front * h;
+}
+
+/* 方法を選ぶ。正規近似は手間が一定なので先に試し，Poissonはその次とする。
+ * scaleは正規近似の上界に掛ける係数(PMFは2)。 */
+static int
+binom_approx_method(int n, double p, double tol, double scale, double *bound)
+{
+	double r = p < 0.5 ? p : 1 - p;
+	double b;
+
+	if (r == 0)
+		return *bound = 0, BINOM_EXACT;
+	b = scale * BINOM_BERRY_ESSEEN * (p * p + (1 - p) * (1 - p)) / sqrt(n * p * (1 - p));
+	if (b <= tol)
+		return *bound = b, BINOM_NORMAL;
+	b = (1 - exp(-n * r)) * r;
+	if (b <= tol)
+		return *bound = b, BINOM_POISSON;
+	return *bound = 0, BINOM_EXACT;
+}
+
+/* 近似つき確率質量関数 */
+binom_approx_t
+binompmf_approx(int x, int n, double p, double tol)
+{
+	binom_approx_t a;
+	double lam, mu, sd;
+
+	if (p < 0.0 || p > 1.0 || p != p || n <= 0)
+	{
+		a.value = NAN;  a.bound = 0;  a.method = BINOM_EXACT;
+		return a;
+	}
+	a.method = binom_approx_method(n, p, tol, 2.0, &a.bound);
+	if (x < 0 || x > n)
+	{
+		a.value = 0.0;
+		return a;
+	}
+	switch (a.method) {
+	case BINOM_POISSON:
+		if (p > 0.5)  {  x = n - x;  p = 1 - p;  }
+		lam = n * p;
+		a.value = exp(x * log(lam) - lam - logfact(x));
+		break;
+	case BINOM_NORMAL:
+		mu = n * p;  sd = sqrt(mu * (1 - p)) * M_SQRT2;
+		a.value = 0.5 * (erfc((mu - x - 0.5) / sd) - erfc((mu - x + 0.5) / sd));
+		break;
+	default:
+	{
+		PROBE_TIMER_START(t0, PROBE_T_BINOM_EXACT);
+
+		PROBE_COUNT(PROBE_BINOM_EXACT, 1);
+		a.value = binompmf(x, n, p);
+		PROBE_TIMER_STOP(t0, PROBE_T_BINOM_EXACT);
+		break;
+	}
+	}
+	return a;
+}
+
+/* 近似つき累積分布関数 */
+binom_approx_t
+binomcdf_approx(int k, int n, double p, double tol)
+{
+	binom_approx_t a;
+	double mu, sd;
+
+	if (p < 0.0 || p > 1.0 || p != p || n <= 0)
+	{
+		a.value = NAN;  a.bound = 0;  a.method = BINOM_EXACT;
+		return a;
+	}
+	a.method = binom_approx_method(n, p, tol, 1.0, &a.bound);
+	if (k < 0 || k >= n)
+	{
+		a.value = k < 0 ? 0.0 : 1.0;
+		return a;
+	}
+	switch (a.method) {
+	case BINOM_POISSON:
+		if (p > 0.5)  /* $P(X \leq k) = P(n - X \geq n - k)$ */
+			a.value = binom_gammq(n - k, n * (1 - p));
+		else
+			a.value = binom_gammq(k + 1.0, n * p);
+		if (p > 0.5)  a.value = 1.0 - a.value;
+		break;
+	case BINOM_NORMAL:
+		mu = n * p;  sd = sqrt(mu * (1 - p)) * M_SQRT2;
+		a.value = 0.5 * erfc((mu - k - 0.5) / sd);
+		break;
+	default:
+	{
+		PROBE_TIMER_START(t0, PROBE_T_BINOM_EXACT);
+
+		PROBE_COUNT(PROBE_BINOM_EXACT, 1);
+		a.value = binomcdf(k, n, p);
+		PROBE_TIMER_STOP(t0, PROBE_T_BINOM_EXACT);
+		break;
+	}
+	}
+	return a;
+}
+
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+/* 近似エンジンのベンチマーク
+ * パラメータ空間を掃いて，厳密値に対する最大誤差と上界，1回あたりの時間を出す。
+ */
+static void
+binom_approx_bench(void)
+{
+	static const int ns[] = { 1000, 100000, 10000000 };
+	static const double ps[] = { 1e-5, 1e-3, 1e-2, 0.1, 0.5, 0.9 };
+	const double tol = 1e-2;
+	int i, j, k, m, cnt;
+
+	puts("approx: n         p       method  bound     max|err|  exact[ns]  approx[ns]");
+	for (i = 0; i < (int)(sizeof ns / sizeof ns[0]); i++)
+		for (j = 0; j < (int)(sizeof ps / sizeof ps[0]); j++)
+		{
+			int n = ns[i];
+			double p = ps[j], sd = sqrt(n * p * (1 - p)), err = 0, sink = 0;
+			double k0 = n * p - 6 * sd - 1, dk = (12 * sd + 2) / 200;
+			binom_approx_t a;
+			clock_t c0, c1, c2;
+
+			c0 = clock();
+			for (m = cnt = 0; m < 20; m++)
+				for (k = 0; k <= 200; k++, cnt++)
+					sink += binomcdf((int)(k0 + k * dk), n, p);
+			c1 = clock();
+			for (m = 0; m < 20; m++)
+				for (k = 0; k <= 200; k++)
+					sink += binomcdf_approx((int)(k0 + k * dk), n, p, tol).value;
+			c2 = clock();
+			for (k = 0; k <= 200; k++)
+			{
+				int kk = (int)(k0 + k * dk);
+				double e = fabs(binomcdf_approx(kk, n, p, tol).value - binomcdf(kk, n, p));
+
+				if (e > err)  err = e;
+			}
+			a = binomcdf_approx(0, n, p, tol);
+			printf("        %-9d %-7g %-7s %-9.2e %-9.2e %-10.1f %-10.1f%s\n", n, p,
+			       a.method == BINOM_POISSON ? "poisson" : a.method == BINOM_NORMAL ? "normal" : "exact",
+			       a.bound, err, 1e9 * (c1 - c0) / CLOCKS_PER_SEC / cnt,
+			       1e9 * (c2 - c1) / CLOCKS_PER_SEC / cnt, sink < 0 ? "!" : "");
+		}
+}
+
+int
+main(void)
+{
+	binom_param_t param;
+	int n, bad = 0;
+	double p;
+
+	printf("n, p? ");  scanf("%d%lf", &n, &p);
+	binom_enum_initialize(n, p, &param);
+	
+	puts(" (n) CDF               PMF               I_{1-p}(n-k, k+1)");
+	while (param.status != ITERATOR_AN_END) {
+		printf("%4d %16.15f %16.15f %16.15f\n", param.k, param.s, param.t,
+		       binomcdf(param.k, n, p));
+		binom_each_yield(&param);
+	}
+
+	{
+		binom_sampler_t smp;
+		static int x[1000000];
+		double m1 = 0, m2 = 0;
+		int i;
+
+		binom_sampler_initialize(n, p, 1, &smp);
+		binom_sample_fill(&smp, x, 1000000);
+		for (i = 0; i < 1000000; i++)  {  m1 += x[i];  m2 += (double)x[i] * x[i];  }
+		m1 /= 1000000;  m2 = m2 / 1000000 - m1 * m1;
+		printf("sampler(%s): mean %f (np = %f), var %f (npq = %f)\n",
+		       smp.btpe ? "BTPE" : "inversion", m1, n * p, m2, n * p * (1 - p));
+	}
+
+	{
+		binom_cache_stats_t st;
+
+		printf("cache: median %d, CDF(median) %16.15f\n",
+		       binom_cache_quantile(0.5, n, p), binom_cache_cdf(binom_cache_quantile(0.5, n, p), n, p));
+		binom_cache_stats(&st);
+		printf("cache: hits %lu, misses %lu, evictions %lu\n", st.hits, st.misses, st.evictions);
+	}
+
+	{
+		/* 誤った引数ではerror()で止めず，NaN / -1を返すこと */
+		static const int bn[] = { 0, -3, 10, 10, 10 };
+		static const double bp[] = { 0.5, 0.5, -0.25, 1.5, NAN };
+		double cdf[4];
+		int i, x = 0;
+
+		for (i = 0; i < (int)(sizeof bn / sizeof bn[0]); i++)
+		{
+			binom_cache_sample_fill(bn[i], bp[i], &p, &x, 1);
+			if (!isnan(binom_cache_cdf(0, bn[i], bp[i])) ||
+			    binom_cache_quantile(0.5, bn[i], bp[i]) != -1 || x != -1 ||
+			    binom_fill(bn[i], bp[i], NULL, cdf, 0, 3) != -1)
+				bad++;
+		}
+		if (binom_fill(n, p, NULL, cdf, -1, 2) != -1 || binom_fill(n, p, NULL, cdf, 2, 1) != -1 ||
+		    binom_fill(n, p, NULL, cdf, n - 1, n + 1) != -1)
+			bad++;
+		printf("invalid arguments: %s\n", bad ? "NG" : "ok");
+	}
+
+	binom_approx_bench();
+	return bad != 0;
+}
+#endif /* ALGO_NO_MAIN */
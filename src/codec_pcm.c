@@ -1,381 +1,561 @@
-/***********************************************************************
-	codec_pcm.c -- パルス符号変調
-***********************************************************************/
-
-/* pio_p.h */
-
-#include <stdint.h>
-#include <math.h> /* floor(), HUGE_VAL */
-
-typedef volatile double io_snddata_t;
-typedef volatile uint8_t io_bindata_t;
-
-typedef struct {
-	io_snddata_t s;
-	io_bindata_t b1;
-	io_bindata_t b2;
-	io_bindata_t b3;
-	io_bindata_t b4;
-} pio_broker_t;
-
-#define DECODE 0
-#define ENCODE 1
-
-/* Codec's Singleton Functions
-Declare of Callback function of codecs
-typedef void (* codec_ptr[CODEC_PATT][CODEC_TYPE])(pio_broker_t *);
-CODEC_PATT .. 0 is Decode, 1 is Encode. Use constant DECODE / ENCODE
-CODEC_TYPE .. Each these format of type
- */
-
-/* Wave format information is crowds into main function as a parameter setting */
-
-//0x0001  WAVE_FORMAT_PCM
-void dec_pcm8bit(pio_broker_t*);
-void dec_pcm16bit(pio_broker_t*);
-void dec_pcm24bit(pio_broker_t*);
-void dec_pcm32bit(pio_broker_t*);
-void enc_pcm8bit(pio_broker_t*);
-void enc_pcm16bit(pio_broker_t*);
-void enc_pcm24bit(pio_broker_t*);
-void enc_pcm32bit(pio_broker_t*);
-
-typedef void (* lpcmcodec_tab[2][4])(pio_broker_t *);
-const lpcmcodec_tab lpcm_codec =
-	{
-		{ dec_pcm8bit, dec_pcm16bit, dec_pcm24bit, dec_pcm32bit },
-		{ enc_pcm8bit, enc_pcm16bit, enc_pcm24bit, enc_pcm32bit }
-	};
-
-
-/* end */
-
-/* x0001lpcm.c */
-
-
-/*
- * Variables & Accessory functions.
- */
-
-#define LINEAR_PCM8   0
-#define LINEAR_PCM16  1
-#define LINEAR_PCM24  2
-#define LINEAR_PCM32  3
-
-#define ZERO_FLO             0.0
-#define DWIDTH_X1          256.0
-#define DWIDTH_X2        65536.0
-#define DWIDTH_X3     16777216.0
-#define DWIDTH_X4   4294967296.0
-#define SDWIDTH_X1         128.0
-#define SDWIDTH_X2       32768.0
-#define SDWIDTH_X3     8388608.0
-#define SDWIDTH_X4  2147483648.0
-#define DWIDTH_X1M         255.0
-#define DWIDTH_X2M       65535.0
-#define DWIDTH_X3M    16777215.0
-#define DWIDTH_X4M  4294967295.0
-
-/*
- * Sound-datum AD/DA normalizer.
- * e.g. (16bit) -1.0 to 1.0 -> 0.0 to 65536.0
- */
-static inline double
-sounddata_normalize(register double s, register double bs)
-{
-	return (s + 1.0) / 2.0 * bs;
-}
-
-/*
- * Sound data clamper.
- * e.g. low=0.0 to high=255.0 then sound data is clipped in it.
- */
-static inline double
-s_clamp(register double x, register double low, register double high)
-{
-	return ((x > high) ? high : ((x < low) ? low : x));
-}
-
-/*
- * Cast unsigned char to signable double float.
- * 8-bit of argument must be have MSB.
- * 0x00 .. 0x7F -> Floating point as it is
- * 0x80 .. 0xFF -> Signed floating point
- */
-static double
-uchar2sgndbl(register uint8_t s)
-{
-	return (s >= 128 ? -(DWIDTH_X1-s) : (double)s);
-}
-
-/*
- * On digitize of sign to unsign.
- * This is referenced from Ruby's Math.gamma (by CoreCommitter nobu)
- * Because the data width is confident, the HUGE_VAL is returned as
- * a return value when a value of 4 or more is passed to byte_length
- * temporary argument.
- */
-#define numberof(arr)  (sizeof (arr) / sizeof ((arr)[0]))
-static double
-digit_sgn2usgn(register double data, register uint8_t byte_length)
-{
-	static const double bytesize_table[] = {
-		/*  8bit(0) */ DWIDTH_X1,
-		/* 16bit(1) */ DWIDTH_X2,
-		/* 24bit(2) */ DWIDTH_X3,
-		/* 32bit(3) */ DWIDTH_X4
-    };
-	enum {NBYTESIZE_TABLE = numberof(bytesize_table)};
-	if (byte_length >= NBYTESIZE_TABLE)  return HUGE_VAL;
-	return floor(data < ZERO_FLO ? -(bytesize_table[byte_length]-data) : data);
-}
-
-/*
- * Linear PCM Formulas.
- * AD/DA is calculated with a double float value, which follows a polynomial approximation.
- * (Taylor series)
- * e.g. 16bit of -1(=\xFF\xFF) == (MSB)0xFFsigned=-1x(coef:x1=)256.0=-256.0 + (LSB)255.0
- * e.g. 24bit of -1(=\xFF\xFF\xFF) == (MSB)0xFFsigned=-1x(coef:x2=)65536.0=-65536.0 + (HSB)255.0x(coef:x1)256.0=65280.0 + (LSB)255.0
- * In addition: This way seems to be called 'Galois Field'.
- */
-static inline double
-formula_dec_pcm8bit(register uint8_t b1)
-{
-	return ((double)b1 - SDWIDTH_X1) / SDWIDTH_X1;
-}
-
-static inline double
-formula_dec_pcm16bit(register uint8_t b1, register uint8_t b2)
-{
-	register double data = (uchar2sgndbl(b2)*DWIDTH_X1 + (double)b1);
-	return data / SDWIDTH_X2;
-}
-
-static inline double
-formula_dec_pcm24bit(register uint8_t b1, register uint8_t b2, register uint8_t b3)
-{
-	register double data = (uchar2sgndbl(b3)*DWIDTH_X2 + (double)b2*DWIDTH_X1 + (double)b1);
-	return data / SDWIDTH_X3;
-}
-
-static inline double
-formula_dec_pcm32bit(register uint8_t b1, register uint8_t b2, register uint8_t b3, register uint8_t b4)
-{
-	register double data = (uchar2sgndbl(b4)*DWIDTH_X3 + (double)b3*DWIDTH_X2 + (double)b2*DWIDTH_X1 + (double)b1);
-	return data / SDWIDTH_X4;
-}
-
-static inline double
-formula_enc_pcm8bit(register double s)
-{
-	return sounddata_normalize(s, DWIDTH_X1);
-}
-
-static inline double
-formula_enc_pcm16bit(register double s)
-{
-	return sounddata_normalize(s, DWIDTH_X2);
-}
-
-static inline double
-formula_enc_pcm24bit(register double s)
-{
-	return sounddata_normalize(s, DWIDTH_X3);
-}
-
-static inline double
-formula_enc_pcm32bit(register double s)
-{
-	return sounddata_normalize(s, DWIDTH_X4);
-}
-
-/*
- * Entity of encode/decode that Linear PCM
- * 
- * b1->b4: Little endian(for RIFF), b4->b1: Big endian(for AIFF)
- */
-
-void
-dec_pcm8bit(pio_broker_t *bro)
-{
-	bro->s = formula_dec_pcm8bit(bro->b1);
-}
-
-void
-dec_pcm16bit(pio_broker_t *bro)
-{
-	bro->s = formula_dec_pcm16bit(bro->b1, bro->b2);
-}
-
-void
-dec_pcm24bit(pio_broker_t *bro)
-{
-	bro->s = formula_dec_pcm24bit(bro->b1, bro->b2, bro->b3);
-}
-
-void
-dec_pcm32bit(pio_broker_t *bro)
-{
-	bro->s = formula_dec_pcm32bit(bro->b1, bro->b2, bro->b3, bro->b4);
-}
-
-void
-enc_pcm8bit(pio_broker_t *bro)
-{
-	/* clipping */
-	double data = s_clamp(formula_enc_pcm8bit(bro->s), ZERO_FLO, DWIDTH_X1M);
-	/* rounding & digitize & writing */
-	bro->b1 = (uint8_t)((int)(data + 0.5));
-}
-
-void
-enc_pcm16bit(pio_broker_t *bro)
-{
-	/* clipping */
-	double data = s_clamp(formula_enc_pcm16bit(bro->s), ZERO_FLO, DWIDTH_X2M);
-	/* rounding & digitize */
-	unsigned short digitize = (unsigned short)digit_sgn2usgn(data + 0.5 - SDWIDTH_X2, LINEAR_PCM16);
-	/* writing */
-	bro->b1 = (uint8_t)(digitize & 0xFF);
-	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
-}
-
-void
-enc_pcm24bit(pio_broker_t *bro)
-{
-	/* clipping */
-	double data = s_clamp(formula_enc_pcm24bit(bro->s), ZERO_FLO, DWIDTH_X3M);
-	/* rounding & digitize */
-	unsigned long digitize = (unsigned long)digit_sgn2usgn(data + 0.5 - SDWIDTH_X3, LINEAR_PCM24);
-	/* writing */
-	bro->b1 = (uint8_t)(digitize & 0xFF);
-	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
-	bro->b3 = (uint8_t)((digitize >> 16) & 0xFF);
-}
-
-void
-enc_pcm32bit(pio_broker_t *bro)
-{
-	/* clipping */
-	double data = s_clamp(formula_enc_pcm32bit(bro->s), ZERO_FLO, DWIDTH_X4M);
-	/* rounding & digitize */
-	unsigned long digitize = (unsigned long)digit_sgn2usgn(data + 0.5 - SDWIDTH_X4, LINEAR_PCM32);
-	/* writing */
-	bro->b1 = (uint8_t)(digitize & 0xFF);
-	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
-	bro->b3 = (uint8_t)((digitize >> 16) & 0xFF);
-	bro->b4 = (uint8_t)((digitize >> 24) & 0xFF);
-}
-
-
-//----------
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-
-double GetRandom(void);
-
-int main(void)
-{
-	pio_broker_t bro;
-	uint8_t rsvbits;
-	
-	srand(time(NULL));
-	
-	bro.s = 0.0;
-	bro.b1 = bro.b2 = bro.b3 = bro.b4 = 0;
-	
-#define info  (printf("PCM %2dBIT: (Sound data: %f)\n", 8*(rsvbits+1), bro.s))
-#define print_enc { \
-  switch(rsvbits){\
-  case LINEAR_PCM8:\
-	printf("Encode: %02X\n", bro.b1);\
-	break;\
-  case LINEAR_PCM16:\
-	printf("Encode: %02X %02X\n", bro.b1, bro.b2);\
-	break;\
-  case LINEAR_PCM24:\
-    printf("Encode: %02X %02X %02X\n", bro.b1, bro.b2, bro.b3);\
-    break;\
-  case LINEAR_PCM32:\
-    printf("Encode: %02X %02X %02X %02X\n", bro.b1, bro.b2, bro.b3, bro.b4);\
-    break;\
-  default:\
-    break;\
-  }\
-}
-#define print_dec  (printf("Decode: %f\n", bro.s))
-#define show_codec {                 \
-  info;                              \
-  lpcm_codec[ENCODE][rsvbits](&bro); \
-  print_enc;                         \
-  lpcm_codec[DECODE][rsvbits](&bro); \
-  print_dec;                         \
-  puts("");                          \
-}
-
-	printf("Linear PCM Encoder/Decoder Test \n");
-	puts("");
-	// value: -1.0
-	printf("Test for value -1.0.\n");
-	
-	rsvbits = LINEAR_PCM8;
-	bro.s = -1.0;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM16;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM24;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM32;
-	show_codec;
-	
-	// value: 1.0
-	printf("Test for value 1.0.\n");
-	
-	rsvbits = LINEAR_PCM8;
-	bro.s = 1.0;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM16;
-	bro.s = 1.0;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM24;
-	bro.s = 1.0;
-	show_codec;
-	
-	rsvbits = LINEAR_PCM32;
-	bro.s = 1.0;
-	show_codec;
-	
-	// random value
-	printf("Test for random value.\n");
-	
-	rsvbits = LINEAR_PCM8;
-	bro.s = GetRandom();
-	show_codec;
-	
-	rsvbits = LINEAR_PCM16;
-	bro.s = GetRandom();
-	show_codec;
-	
-	rsvbits = LINEAR_PCM24;
-	bro.s = GetRandom();
-	show_codec;
-	
-	rsvbits = LINEAR_PCM32;
-	bro.s = GetRandom();
-	show_codec;
-	
-	return 0;
-}
-
-double
-GetRandom(void)
-{
-	return 1.0 - (rand() / (double)RAND_MAX) * 2.0;
-}
+/***********************************************************************
+	codec_pcm.c -- パルス符号変調
+***********************************************************************/
+
+#include "pio.h"
+#include "pio_sat.h"
+#include "probe.h"  /* -DALGO_PROBEのときだけ数える */
+
+const lpcmcodec_tab lpcm_codec =
+	{
+		{ dec_pcm8bit, dec_pcm16bit, dec_pcm24bit, dec_pcm32bit },
+		{ enc_pcm8bit, enc_pcm16bit, enc_pcm24bit, enc_pcm32bit }
+	};
+
+/* x0001lpcm.c */
+
+
+/*
+ * Variables & Accessory functions.
+ */
+
+#define ZERO_FLO             0.0
+#define DWIDTH_X1          256.0
+#define DWIDTH_X2        65536.0
+#define DWIDTH_X3     16777216.0
+#define DWIDTH_X4   4294967296.0
+#define SDWIDTH_X1         128.0
+#define SDWIDTH_X2       32768.0
+#define SDWIDTH_X3     8388608.0
+#define SDWIDTH_X4  2147483648.0
+#define DWIDTH_X1M         255.0
+#define DWIDTH_X2M       65535.0
+#define DWIDTH_X3M    16777215.0
+#define DWIDTH_X4M  4294967295.0
+
+/*
+ * Cast unsigned char to signable double float.
+ * 8-bit of argument must be have MSB.
+ * 0x00 .. 0x7F -> Floating point as it is
+ * 0x80 .. 0xFF -> Signed floating point
+ */
+static double
+uchar2sgndbl(register uint8_t s)
+{
+	return (s >= 128 ? -(DWIDTH_X1-s) : (double)s);
+}
+
+/*
+ * Linear PCM Formulas.
+ * AD/DA is calculated with a double float value, which follows a polynomial approximation.
+ * (Taylor series)
+ * e.g. 16bit of -1(=\xFF\xFF) == (MSB)0xFFsigned=-1x(coef:x1=)256.0=-256.0 + (LSB)255.0
+ * e.g. 24bit of -1(=\xFF\xFF\xFF) == (MSB)0xFFsigned=-1x(coef:x2=)65536.0=-65536.0 + (HSB)255.0x(coef:x1)256.0=65280.0 + (LSB)255.0
+ * In addition: This way seems to be called 'Galois Field'.
+ */
+static inline double
+formula_dec_pcm8bit(register uint8_t b1)
+{
+	return ((double)b1 - SDWIDTH_X1) / SDWIDTH_X1;
+}
+
+static inline double
+formula_dec_pcm16bit(register uint8_t b1, register uint8_t b2)
+{
+	register double data = (uchar2sgndbl(b2)*DWIDTH_X1 + (double)b1);
+	return data / SDWIDTH_X2;
+}
+
+static inline double
+formula_dec_pcm24bit(register uint8_t b1, register uint8_t b2, register uint8_t b3)
+{
+	register double data = (uchar2sgndbl(b3)*DWIDTH_X2 + (double)b2*DWIDTH_X1 + (double)b1);
+	return data / SDWIDTH_X3;
+}
+
+static inline double
+formula_dec_pcm32bit(register uint8_t b1, register uint8_t b2, register uint8_t b3, register uint8_t b4)
+{
+	register double data = (uchar2sgndbl(b4)*DWIDTH_X3 + (double)b3*DWIDTH_X2 + (double)b2*DWIDTH_X1 + (double)b1);
+	return data / SDWIDTH_X4;
+}
+
+static inline double
+formula_enc_pcm8bit(register double s)
+{
+	return s * SDWIDTH_X1;
+}
+
+static inline double
+formula_enc_pcm16bit(register double s)
+{
+	return s * SDWIDTH_X2;
+}
+
+static inline double
+formula_enc_pcm24bit(register double s)
+{
+	return s * SDWIDTH_X3;
+}
+
+static inline double
+formula_enc_pcm32bit(register double s)
+{
+	return s * SDWIDTH_X4;
+}
+
+/*
+ * Entity of encode/decode that Linear PCM
+ * 
+ * b1->b4: Little endian(for RIFF), b4->b1: Big endian(for AIFF)
+ */
+
+void
+dec_pcm8bit(pio_broker_t *bro)
+{
+	PROBE_COUNT(PROBE_LPCM8_DEC, 1);
+	bro->s = formula_dec_pcm8bit(bro->b1);
+}
+
+void
+dec_pcm16bit(pio_broker_t *bro)
+{
+	PROBE_COUNT(PROBE_LPCM16_DEC, 1);
+	bro->s = formula_dec_pcm16bit(bro->b1, bro->b2);
+}
+
+void
+dec_pcm24bit(pio_broker_t *bro)
+{
+	PROBE_COUNT(PROBE_LPCM24_DEC, 1);
+	bro->s = formula_dec_pcm24bit(bro->b1, bro->b2, bro->b3);
+}
+
+void
+dec_pcm32bit(pio_broker_t *bro)
+{
+	PROBE_COUNT(PROBE_LPCM32_DEC, 1);
+	bro->s = formula_dec_pcm32bit(bro->b1, bro->b2, bro->b3, bro->b4);
+}
+
+void
+enc_pcm8bit(pio_broker_t *bro)
+{
+	double v = formula_enc_pcm8bit(bro->s);
+
+	PROBE_COUNT(PROBE_LPCM8_ENC, 1);
+	PROBE_COUNT(PROBE_LPCM8_CLIP, sat_clipped(v, 128.5, 255.0));
+	/* rounding & clipping & digitize & writing */
+	bro->b1 = sat_round_to_u8(v);
+}
+
+void
+enc_pcm16bit(pio_broker_t *bro)
+{
+	double v = formula_enc_pcm16bit(bro->s);
+	uint16_t digitize;
+
+	PROBE_COUNT(PROBE_LPCM16_ENC, 1);
+	PROBE_COUNT(PROBE_LPCM16_CLIP, sat_clipped(v, 32768.5, 65535.0));
+	/* rounding & clipping & digitize */
+	digitize = (uint16_t)sat_round_to_s16(v);
+	/* writing */
+	bro->b1 = (uint8_t)(digitize & 0xFF);
+	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
+}
+
+void
+enc_pcm24bit(pio_broker_t *bro)
+{
+	double v = formula_enc_pcm24bit(bro->s);
+	uint32_t digitize;
+
+	PROBE_COUNT(PROBE_LPCM24_ENC, 1);
+	PROBE_COUNT(PROBE_LPCM24_CLIP, sat_clipped(v, 8388608.5, 16777215.0));
+	/* rounding & clipping & digitize */
+	digitize = (uint32_t)sat_round_to_s24(v);
+	/* writing */
+	bro->b1 = (uint8_t)(digitize & 0xFF);
+	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
+	bro->b3 = (uint8_t)((digitize >> 16) & 0xFF);
+}
+
+void
+enc_pcm32bit(pio_broker_t *bro)
+{
+	double v = formula_enc_pcm32bit(bro->s);
+	uint32_t digitize;
+
+	PROBE_COUNT(PROBE_LPCM32_ENC, 1);
+	PROBE_COUNT(PROBE_LPCM32_CLIP, sat_clipped(v, 2147483648.5, 4294967295.0));
+	/* rounding & clipping & digitize */
+	digitize = (uint32_t)sat_round_to_s32(v);
+	/* writing */
+	bro->b1 = (uint8_t)(digitize & 0xFF);
+	bro->b2 = (uint8_t)((digitize >> 8) & 0xFF);
+	bro->b3 = (uint8_t)((digitize >> 16) & 0xFF);
+	bro->b4 = (uint8_t)((digitize >> 24) & 0xFF);
+}
+
+
+/*
+ * Bulk versions: len samples of s[] <-> the byte stream b[] of the format
+ * (little endian, as in the data chunk of RIFF/WAVE).
+ * They give bit for bit the same as calling dec_pcmXbit()/enc_pcmXbit() per
+ * sample. The loops have neither calls nor data dependent branches, so they
+ * are vectorized; the library builds them for AVX2 and AVX-512 as well and
+ * dispatch.c selects one (Makefile).
+ */
+
+void
+dec_pcm8bit_batch(int len, const uint8_t *b, double *s)
+{
+	int i;
+
+	PROBE_COUNT(PROBE_LPCM8_DEC, len);
+	for (i = 0; i < len; i++)
+		s[i] = formula_dec_pcm8bit(b[i]);
+}
+
+void
+dec_pcm16bit_batch(int len, const uint8_t *b, double *s)
+{
+	int i;
+
+	PROBE_COUNT(PROBE_LPCM16_DEC, len);
+	for (i = 0; i < len; i++)
+		s[i] = (double)(int16_t)(b[2*i] | b[2*i+1] << 8) / SDWIDTH_X2;
+}
+
+void
+dec_pcm24bit_batch(int len, const uint8_t *b, double *s)
+{
+	int i;
+
+	PROBE_COUNT(PROBE_LPCM24_DEC, len);
+	/* the sign of b3 is extended by the arithmetic shift */
+	for (i = 0; i < len; i++)
+		s[i] = (double)((int32_t)((uint32_t)b[3*i] << 8 | (uint32_t)b[3*i+1] << 16 |
+		                          (uint32_t)b[3*i+2] << 24) >> 8) / SDWIDTH_X3;
+}
+
+void
+dec_pcm32bit_batch(int len, const uint8_t *b, double *s)
+{
+	int i;
+
+	PROBE_COUNT(PROBE_LPCM32_DEC, len);
+	for (i = 0; i < len; i++)
+		s[i] = (double)(int32_t)((uint32_t)b[4*i] | (uint32_t)b[4*i+1] << 8 |
+		                         (uint32_t)b[4*i+2] << 16 | (uint32_t)b[4*i+3] << 24) / SDWIDTH_X4;
+}
+
+void
+enc_pcm8bit_batch(int len, const double *s, uint8_t *b)
+{
+	double v;
+	int i;
+	PROBE_TALLY_DECL(clip);
+
+	PROBE_COUNT(PROBE_LPCM8_ENC, len);
+	for (i = 0; i < len; i++)
+	{
+		v = formula_enc_pcm8bit(s[i]);
+		PROBE_TALLY(clip, sat_clipped(v, 128.5, 255.0));
+		b[i] = sat_round_to_u8(v);
+	}
+	PROBE_COUNT(PROBE_LPCM8_CLIP, clip);
+}
+
+void
+enc_pcm16bit_batch(int len, const double *s, uint8_t *b)
+{
+	uint16_t digitize;
+	double v;
+	int i;
+	PROBE_TALLY_DECL(clip);
+
+	PROBE_COUNT(PROBE_LPCM16_ENC, len);
+	for (i = 0; i < len; i++)
+	{
+		v = formula_enc_pcm16bit(s[i]);
+		PROBE_TALLY(clip, sat_clipped(v, 32768.5, 65535.0));
+		digitize = (uint16_t)sat_round_to_s16(v);
+		b[2*i]   = (uint8_t)(digitize & 0xFF);
+		b[2*i+1] = (uint8_t)(digitize >> 8);
+	}
+	PROBE_COUNT(PROBE_LPCM16_CLIP, clip);
+}
+
+void
+enc_pcm24bit_batch(int len, const double *s, uint8_t *b)
+{
+	uint32_t digitize;
+	double v;
+	int i;
+	PROBE_TALLY_DECL(clip);
+
+	PROBE_COUNT(PROBE_LPCM24_ENC, len);
+	for (i = 0; i < len; i++)
+	{
+		v = formula_enc_pcm24bit(s[i]);
+		PROBE_TALLY(clip, sat_clipped(v, 8388608.5, 16777215.0));
+		digitize = (uint32_t)sat_round_to_s24(v);
+		b[3*i]   = (uint8_t)(digitize & 0xFF);
+		b[3*i+1] = (uint8_t)((digitize >> 8) & 0xFF);
+		b[3*i+2] = (uint8_t)((digitize >> 16) & 0xFF);
+	}
+	PROBE_COUNT(PROBE_LPCM24_CLIP, clip);
+}
+
+void
+enc_pcm32bit_batch(int len, const double *s, uint8_t *b)
+{
+	uint32_t digitize;
+	double v;
+	int i;
+	PROBE_TALLY_DECL(clip);
+
+	PROBE_COUNT(PROBE_LPCM32_ENC, len);
+	for (i = 0; i < len; i++)
+	{
+		v = formula_enc_pcm32bit(s[i]);
+		PROBE_TALLY(clip, sat_clipped(v, 2147483648.5, 4294967295.0));
+		digitize = (uint32_t)sat_round_to_s32(v);
+		b[4*i]   = (uint8_t)(digitize & 0xFF);
+		b[4*i+1] = (uint8_t)((digitize >> 8) & 0xFF);
+		b[4*i+2] = (uint8_t)((digitize >> 16) & 0xFF);
+		b[4*i+3] = (uint8_t)(digitize >> 24);
+	}
+	PROBE_COUNT(PROBE_LPCM32_CLIP, clip);
+}
+
+//----------
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+double GetRandom(void);
+
+/* Special inputs: NaN is silence, the infinities and |s| >= 1 saturate, and
+ * the half-way points v + 0.5 (v in LSB) round up, i.e. floor(v + 0.5). */
+static int
+check_special(void)
+{
+	static const double lsb[4] = { 0x1p-7, 0x1p-15, 0x1p-23, 0x1p-31 };
+	static const double clip[] = { NAN, HUGE_VAL, -HUGE_VAL, 1.5, -1.5, 1.0, -1.0, 0.0, -0.0 };
+	static const int    clipk[] = { 0, 1, -1, 1, -1, 1, -1, 0, 0 }; /* 1: max, -1: min */
+	static const double half[] = { 0.5, -0.5, 1.5, -1.5, 2.5, -2.5, 0.49, -0.51 };
+	static const int    halfk[] = { 1, 0, 2, -1, 3, -2, 0, -1 };
+	const int nclip = sizeof clip / sizeof clip[0];
+	const int nhalf = sizeof half / sizeof half[0];
+	pio_broker_t bro;
+	uint8_t got[4], want[4];
+	int w, i, j, bad = 0;
+
+	for (w = LINEAR_PCM8; w <= LINEAR_PCM32; w++)
+		for (i = 0; i < nclip + nhalf + 1; i++) {
+			int64_t k;
+			uint32_t u;
+
+			if (i < nclip) {
+				bro.s = clip[i];
+				k = clipk[i] > 0 ? (int64_t)(1 / lsb[w]) - 1 : clipk[i] < 0 ? -(int64_t)(1 / lsb[w]) : 0;
+			} else if (i < nclip + nhalf) {
+				bro.s = half[i - nclip] * lsb[w];
+				k = halfk[i - nclip];
+			} else {
+				/* pio_sat.h: v + bias is rounded first, so this rounds up at 24 and 32bit */
+				bro.s = (0.5 - 0x1p-30) * lsb[w];
+				k = w >= LINEAR_PCM24;
+			}
+			lpcm_codec[ENCODE][w](&bro);
+			got[0] = bro.b1; got[1] = bro.b2; got[2] = bro.b3; got[3] = bro.b4;
+			u = (uint32_t)k + (w == LINEAR_PCM8 ? 128 : 0);
+			for (j = 0; j <= w; j++)
+				want[j] = (uint8_t)(u >> 8*j);
+			for (j = 0; j <= w; j++)
+				if (got[j] != want[j]) break;
+			if (j <= w) {
+				printf("PCM %2dBIT: %a gives", 8*(w+1), (double)bro.s);
+				for (j = 0; j <= w; j++) printf(" %02X", got[j]);
+				printf(", expected");
+				for (j = 0; j <= w; j++) printf(" %02X", want[j]);
+				puts("");
+				bad++;
+			}
+		}
+	printf("Special values: %d mismatches\n\n", bad);
+	return bad;
+}
+
+/* The batch codecs must give bit for bit what the per-sample ones give:
+ * random data in [-1.5, 1.5], the special values and the half-way points
+ * of each width; decoding takes random bytes. */
+static int
+check_batch(void)
+{
+	enum { N = 200000, NHALF = 4000 };
+	static const double lsb[4] = { 0x1p-7, 0x1p-15, 0x1p-23, 0x1p-31 };
+	static const double sp[] = { NAN, -NAN, HUGE_VAL, -HUGE_VAL, 0.0, -0.0, 1.0, -1.0,
+	                             1.5, -1.5, 1e300, -1e300, 1e-310, -1e-310 };
+	static void (*const enc[4])(int, const double *, uint8_t *) = {
+		enc_pcm8bit_batch, enc_pcm16bit_batch, enc_pcm24bit_batch, enc_pcm32bit_batch };
+	static void (*const dec[4])(int, const uint8_t *, double *) = {
+		dec_pcm8bit_batch, dec_pcm16bit_batch, dec_pcm24bit_batch, dec_pcm32bit_batch };
+	static double s[N], t[N];
+	static uint8_t b[4 * N];
+	const int nsp = sizeof sp / sizeof sp[0];
+	pio_broker_t bro;
+	uint8_t got[4];
+	double d;
+	int w, i, bad = 0;
+
+	srand(1);
+	for (w = LINEAR_PCM8; w <= LINEAR_PCM32; w++) {
+		for (i = 0; i < N; i++)
+			s[i] = i < nsp ? sp[i]
+			     : i < nsp + NHALF ? (i - nsp - NHALF / 2 + 0.5) * lsb[w]
+			     : 1.5 - 3.0 * rand() / RAND_MAX;
+		enc[w](N, s, b);
+		for (i = 0; i < N; i++) {
+			bro.s = s[i];
+			lpcm_codec[ENCODE][w](&bro);
+			got[0] = bro.b1; got[1] = bro.b2; got[2] = bro.b3; got[3] = bro.b4;
+			if (memcmp(got, b + (w + 1) * i, w + 1) != 0) {
+				if (bad++ < 10) printf("PCM %2dBIT: batch encodes %a differently\n", 8*(w+1), s[i]);
+			}
+		}
+
+		for (i = 0; i < (w + 1) * N; i++)
+			b[i] = (uint8_t)rand();
+		dec[w](N, b, t);
+		for (i = 0; i < N; i++) {
+			uint8_t *p = b + (w + 1) * i;
+
+			bro.b1 = p[0];
+			bro.b2 = w >= LINEAR_PCM16 ? p[1] : 0;
+			bro.b3 = w >= LINEAR_PCM24 ? p[2] : 0;
+			bro.b4 = w >= LINEAR_PCM32 ? p[3] : 0;
+			lpcm_codec[DECODE][w](&bro);
+			d = bro.s;
+			if (memcmp(&d, &t[i], sizeof d) != 0) {
+				if (bad++ < 10) printf("PCM %2dBIT: batch decodes %a, per-sample %a\n", 8*(w+1), t[i], d);
+			}
+		}
+	}
+	printf("Batch vs per-sample: %d mismatches in %d samples\n\n", bad, 8 * N);
+	return bad;
+}
+
+int main(void)
+{
+	pio_broker_t bro;
+	uint8_t rsvbits;
+	int bad;
+	
+	bad = check_special();
+	bad += check_batch();
+	srand(time(NULL));
+	
+	bro.s = 0.0;
+	bro.b1 = bro.b2 = bro.b3 = bro.b4 = 0;
+	
+#define info  (printf("PCM %2dBIT: (Sound data: %f)\n", 8*(rsvbits+1), bro.s))
+#define print_enc { \
+  switch(rsvbits){\
+  case LINEAR_PCM8:\
+	printf("Encode: %02X\n", bro.b1);\
+	break;\
+  case LINEAR_PCM16:\
+	printf("Encode: %02X %02X\n", bro.b1, bro.b2);\
+	break;\
+  case LINEAR_PCM24:\
+    printf("Encode: %02X %02X %02X\n", bro.b1, bro.b2, bro.b3);\
+    break;\
+  case LINEAR_PCM32:\
+    printf("Encode: %02X %02X %02X %02X\n", bro.b1, bro.b2, bro.b3, bro.b4);\
+    break;\
+  default:\
+    break;\
+  }\
+}
+#define print_dec  (printf("Decode: %f\n", bro.s))
+#define show_codec {                 \
+  info;                              \
+  lpcm_codec[ENCODE][rsvbits](&bro); \
+  print_enc;                         \
+  lpcm_codec[DECODE][rsvbits](&bro); \
+  print_dec;                         \
+  puts("");                          \
+}
+
+	printf("Linear PCM Encoder/Decoder Test \n");
+	puts("");
+	// value: -1.0
+	printf("Test for value -1.0.\n");
+	
+	rsvbits = LINEAR_PCM8;
+	bro.s = -1.0;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM16;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM24;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM32;
+	show_codec;
+	
+	// value: 1.0
+	printf("Test for value 1.0.\n");
+	
+	rsvbits = LINEAR_PCM8;
+	bro.s = 1.0;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM16;
+	bro.s = 1.0;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM24;
+	bro.s = 1.0;
+	show_codec;
+	
+	rsvbits = LINEAR_PCM32;
+	bro.s = 1.0;
+	show_codec;
+	
+	// random value
+	printf("Test for random value.\n");
+	
+	rsvbits = LINEAR_PCM8;
+	bro.s = GetRandom();
+	show_codec;
+	
+	rsvbits = LINEAR_PCM16;
+	bro.s = GetRandom();
+	show_codec;
+	
+	rsvbits = LINEAR_PCM24;
+	bro.s = GetRandom();
+	show_codec;
+	
+	rsvbits = LINEAR_PCM32;
+	bro.s = GetRandom();
+	show_codec;
+	
+	return bad != 0;
+}
+
+double
+GetRandom(void)
+{
+	return 1.0 - (rand() / (double)RAND_MAX) * 2.0;
+}
+#endif /* ALGO_NO_MAIN */
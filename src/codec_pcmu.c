@@ -1,197 +1,300 @@
-﻿/*******************************************************************************
-	codec_pcmu.c -- パルス符号変調
-********************************************************************************/
-#include <stdint.h>
-
-typedef volatile double io_snddata_t;
-typedef volatile uint8_t io_bindata_t;
-
-typedef struct {
-	io_snddata_t s;
-	io_bindata_t b1;
-	io_bindata_t b2;
-	io_bindata_t b3;
-	io_bindata_t b4;
-} pio_broker_t;
-
-#define DECODE 0
-#define ENCODE 1
-
-/*
- * Sound-datum AD/DA normalizer.
- * e.g. (16bit) -1.0 to 1.0 -> 0.0 to 65536.0
- */
-static inline double
-sounddata_normalize(register double s, register double bs)
-{
-	return (s + 1.0) / 2.0 * bs;
-}
-
-/*
- * Sound data clamper.
- * e.g. low=0.0 to high=255.0 then sound data is clipped in it.
- */
-static inline double
-s_clamp(register double x, register double low, register double high)
-{
-	return ((x > high) ? high : ((x < low) ? low : x));
-}
-
-
-/* Codec's Singleton Functions
-Declare of Callback function of codecs
-typedef void (* codec_ptr[CODEC_PATT][CODEC_TYPE])(pio_broker_t *);
-CODEC_PATT .. 0 is Decode, 1 is Encode. Use constant DECODE / ENCODE
-CODEC_TYPE .. Each these format of type
- */
-
-/* Wave format information is crowds into main function as a parameter setting */
-
-//0x0007  WAVE_FORMAT_PCMU
-void dec_pcmu(pio_broker_t*);
-void enc_pcmu(pio_broker_t*);
-
-typedef void (* pcmucodec_tab[2][1])(pio_broker_t *);
-const pcmucodec_tab pcmu_codec =
-{
-	{ dec_pcmu },
-	{ enc_pcmu }
-};
-
-static const short PCMU_LEVEL[8] =
-{
-	0x00FF, 0x01FF, 0x03FF, 0x07FF, 0x0FFF, 0x1FFF, 0x3FFF, 0x7FFF
-};
-static const short (*const level)[8] = &PCMU_LEVEL;
-
-/*  */
-static inline double
-formula_dec_pcmu(register uint8_t c)
-{
-	register double s; /* 16bit sound data */
-//	unsigned char c; /* 8bit compressed data */
-	register unsigned char sign, exponent, mantissa;
-	register int magnitude;
-	
-	c = ~c;
-	
-	sign = c & 0x80;
-	exponent = (c >> 4) & 0x07;
-	mantissa = c & 0x0F;
-	
-	magnitude = ((((int)mantissa << 3) + 0x84) << exponent) - 0x84;
-	
-	if (sign == 0x80)
-		s = -(double)((short)magnitude);
-	else
-		s = (double)((short)magnitude);
-	
-    return s / 32768.0; /* Normalize sound data to a range of -1 or more and less than 1. */
-}
-
-static inline unsigned char
-formula_enc_pcmu(register double s)
-{
-	register double x;
-//	register short s; /* 16bit sound data */
-	register unsigned char c; /* 8bit compressed data */
-	register unsigned char sign, exponent, mantissa;
-	register int magnitude;
-	
-	x = sounddata_normalize(s, 65536.0);
-	x = s_clamp(x, 0.0, 65535.0); /* clipping */
-	x = ((x + 0.5) - 32768); /* Rounding and adjusting offsets */
-	
-	if (x < 0)
-	{
-		magnitude = -(int)x;
-		sign = 0x80;
-	}
-	else
-	{
-		magnitude = (int)x;
-		sign = 0x00;
-	}
-	
-	magnitude += 0x84;
-	if (magnitude > 0x7FFF)
-		magnitude = 0x7FFF;
-	
-	for (exponent = 0; exponent < 8; exponent++)
-		if (magnitude <= (*level)[exponent])
-			break;
-	
-	mantissa = (magnitude >> (exponent + 3)) & 0x0F;
-	
-	c = ~(sign | (exponent << 4) | mantissa);
-	
-	return c; /* Export compressed data */
-
-}
-
-/*
- * Entity of encode/decode that mu-law
- */
-
-void
-dec_pcmu(pio_broker_t *bro)
-{
-	bro->s = formula_dec_pcmu(bro->b1);
-}
-
-void
-enc_pcmu(pio_broker_t *bro)
-{
-	bro->b1 = formula_enc_pcmu(bro->s);
-}
-
-//------------------------------------------------------------------------------
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-
-double GetRandom(void);
-
-int
-main(void)
-{
-	pio_broker_t bro;
-	int i;
-	
-	srand(time(NULL));
-	
-	bro.s = 0.0;
-	bro.b1 = bro.b2 = bro.b3 = bro.b4 = 0;
-	
-#define info  (printf("PCMU: (Sound data: %f)\n", bro.s))
-#define print_enc  (printf("Encode: %02X\n", bro.b1))
-#define print_dec  (printf("Decode: %f\n", bro.s))
-#define show_codec {           \
-  info;                        \
-  pcmu_codec[ENCODE][0](&bro); \
-  print_enc;                   \
-  pcmu_codec[DECODE][0](&bro); \
-  print_dec;                   \
-  puts("");                    \
-}
-
-	printf("PCM mu-law Encoder/Decoder Test \n");
-	puts("");
-	
-	// random value
-	printf("Test for random value.\n");
-
-	for (i =0; i < 10; i++)
-	{
-		bro.s = GetRandom();
-		show_codec;
-	}
-	
-	return 0;
-}
-
-double GetRandom(void)
-{
-	return 1.0 - (rand() / (double)RAND_MAX) * 2.0;
-}
+﻿/*******************************************************************************
+	codec_pcmu.c -- パルス符号変調
+********************************************************************************/
+#include <pthread.h>
+#include "pio.h"
+#include "pio_sat.h"
+#include "probe.h"  /* -DALGO_PROBEのときだけ数える */
+
+const pcmucodec_tab pcmu_codec =
+{
+	{ dec_pcmu },
+	{ enc_pcmu }
+};
+
+/*
+ * Segment (exponent) of a magnitude 0 .. 0x7FFF: the smallest e with
+ * magnitude <= 0x00FF, 0x01FF, .., 0x3FFF, 0x7FFF (e = 0 .. 7).
+ * Summing the comparisons instead of searching the levels leaves no branch,
+ * thus the bulk encoder is vectorized.
+ */
+static inline int
+pcmu_segment(int magnitude)
+{
+	return (magnitude > 0x00FF) + (magnitude > 0x01FF) + (magnitude > 0x03FF) +
+	       (magnitude > 0x07FF) + (magnitude > 0x0FFF) + (magnitude > 0x1FFF) +
+	       (magnitude > 0x3FFF);
+}
+
+/*  */
+static inline double
+formula_dec_pcmu(register uint8_t c)
+{
+	register double s; /* 16bit sound data */
+//	unsigned char c; /* 8bit compressed data */
+	register unsigned char sign, exponent, mantissa;
+	register int magnitude;
+	
+	c = ~c;
+	
+	sign = c & 0x80;
+	exponent = (c >> 4) & 0x07;
+	mantissa = c & 0x0F;
+	
+	magnitude = ((((int)mantissa << 3) + 0x84) << exponent) - 0x84;
+	
+	if (sign == 0x80)
+		s = -(double)((short)magnitude);
+	else
+		s = (double)((short)magnitude);
+	
+    return s / 32768.0; /* Normalize sound data to a range of -1 or more and less than 1. */
+}
+
+static inline unsigned char
+formula_enc_pcmu(register double s)
+{
+	register int pcm; /* 16bit sound data */
+	register unsigned char c; /* 8bit compressed data */
+	register unsigned char sign, exponent, mantissa;
+	register int magnitude, mask;
+	
+	pcm = sat_round_to_s16(s * 32768.0); /* Rounding and clipping */
+	
+	/* A negative value takes one's complement, i.e. -1 -> 0 */
+	mask = -(pcm < 0);
+	sign = (unsigned char)(mask & 0x80);
+	magnitude = pcm ^ mask;
+	
+	magnitude += 0x84;
+	magnitude = (magnitude < 0x7FFF) ? magnitude : 0x7FFF;
+	
+	exponent = pcmu_segment(magnitude);
+	
+	mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+	
+	c = ~(sign | (exponent << 4) | mantissa);
+	
+	return c; /* Export compressed data */
+
+}
+
+/*
+ * Entity of encode/decode that mu-law
+ */
+
+void
+dec_pcmu(pio_broker_t *bro)
+{
+	PROBE_COUNT(PROBE_PCMU_DEC, 1);
+	bro->s = formula_dec_pcmu(bro->b1);
+}
+
+void
+enc_pcmu(pio_broker_t *bro)
+{
+	double s = bro->s;
+
+	PROBE_COUNT(PROBE_PCMU_ENC, 1);
+	PROBE_COUNT(PROBE_PCMU_CLIP, sat_clipped(s * 32768.0, 32768.5, 65535.0));
+	bro->b1 = formula_enc_pcmu(s);
+}
+
+/*
+ * Bulk versions (see codec_pcm.c)
+ * The code of a sample depends only on pcm >> 2: bits 0 and 1 of the magnitude
+ * do not carry over the bias 0x84 into the bits kept by the mantissa (shifted
+ * by 3 or more). So the encoder saturates a block to 16 bits (vectorized) and
+ * looks the codes up in a table of 2^14 bytes, which stays in L1. The decoder
+ * looks up a table of the 256 values. Both tables are made on the first call.
+ */
+
+#define PCMU_SHIFT  2
+#define PCMU_BLOCK  256  /* samples saturated at a time */
+
+static uint8_t pcmu_enc_table[1 << (16 - PCMU_SHIFT)];
+static double pcmu_dec_table[256];
+static pthread_once_t pcmu_once = PTHREAD_ONCE_INIT;
+
+static void
+pcmu_table_init(void)
+{
+	int i;
+
+	for (i = 0; i < (1 << (16 - PCMU_SHIFT)); i++)
+		pcmu_enc_table[i] = formula_enc_pcmu((int16_t)(i << PCMU_SHIFT) / 32768.0);
+	for (i = 0; i < 256; i++)
+		pcmu_dec_table[i] = formula_dec_pcmu(i);
+}
+
+void
+dec_pcmu_batch(int len, const uint8_t *b, double *s)
+{
+	int i;
+
+	PROBE_COUNT(PROBE_PCMU_DEC, len);
+	pthread_once(&pcmu_once, pcmu_table_init);
+	for (i = 0; i < len; i++)
+		s[i] = pcmu_dec_table[b[i]];
+}
+
+void
+enc_pcmu_batch(int len, const double *s, uint8_t *b)
+{
+	int16_t pcm[PCMU_BLOCK];
+	int i, j, n;
+	PROBE_TALLY_DECL(clip);
+
+	PROBE_COUNT(PROBE_PCMU_ENC, len);
+	pthread_once(&pcmu_once, pcmu_table_init);
+	for (i = 0; i < len; i += n)
+	{
+		n = (len - i < PCMU_BLOCK) ? len - i : PCMU_BLOCK;
+		for (j = 0; j < n; j++)
+		{
+			PROBE_TALLY(clip, sat_clipped(s[i + j] * 32768.0, 32768.5, 65535.0));
+			pcm[j] = sat_round_to_s16(s[i + j] * 32768.0);
+		}
+		for (j = 0; j < n; j++)
+			b[i + j] = pcmu_enc_table[(uint16_t)pcm[j] >> PCMU_SHIFT];
+	}
+	PROBE_COUNT(PROBE_PCMU_CLIP, clip);
+}
+
+//------------------------------------------------------------------------------
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+double GetRandom(void);
+
+/* Special inputs and the codes they must give. v is in 16bit LSB (s * 32768):
+ * NaN is silence, the infinities and |s| >= 1 saturate, and the 16bit value
+ * is floor(v + 0.5), so the half-way points decide the code. */
+static int
+check_special(void)
+{
+	static const struct { double v; uint8_t code; } tab[] = {
+		{ NAN,       0xFF },
+		{ HUGE_VAL,  0x80 },
+		{ -HUGE_VAL, 0x00 },
+		{ 49152.0,   0x80 },
+		{ -49152.0,  0x00 },
+		{ 32768.0,   0x80 },
+		{ -32768.0,  0x00 },
+		{ 0.0,       0xFF },
+		{ -0.0,      0xFF },
+		{ 3.5,       0xFE },
+		{ 3.49,      0xFF },
+		{ 11.5,      0xFD },
+		{ 11.49,     0xFE },
+		{ -4.5,      0x7F },
+		{ -4.51,     0x7E },
+	};
+	pio_broker_t bro;
+	int i, bad = 0;
+
+	for (i = 0; i < (int)(sizeof tab / sizeof tab[0]); i++) {
+		bro.s = tab[i].v / 32768.0;
+		pcmu_codec[ENCODE][0](&bro);
+		if (bro.b1 != tab[i].code) {
+			printf("PCMU: %a gives %02X, expected %02X\n", tab[i].v, bro.b1, tab[i].code);
+			bad++;
+		}
+	}
+	printf("Special values: %d mismatches\n\n", bad);
+	return bad;
+}
+
+/* The batch codec must give bit for bit what the per-sample one gives:
+ * random data in [-1.5, 1.5], the special values and the half-way points
+ * of the 16bit grid; decoding takes every code and random bytes. */
+static int
+check_batch(void)
+{
+	enum { N = 200000, NHALF = 70000 };
+	static const double sp[] = { NAN, -NAN, HUGE_VAL, -HUGE_VAL, 0.0, -0.0, 1.0, -1.0,
+	                             1.5, -1.5, 1e300, -1e300, 1e-310, -1e-310 };
+	static double s[N], t[N];
+	static uint8_t b[N];
+	const int nsp = sizeof sp / sizeof sp[0];
+	pio_broker_t bro;
+	double d;
+	int i, bad = 0;
+
+	srand(1);
+	for (i = 0; i < N; i++)
+		s[i] = i < nsp ? sp[i]
+		     : i < nsp + NHALF ? (i - nsp - NHALF / 2 + 0.5) / 32768.0
+		     : 1.5 - 3.0 * rand() / RAND_MAX;
+	enc_pcmu_batch(N, s, b);
+	for (i = 0; i < N; i++) {
+		bro.s = s[i];
+		pcmu_codec[ENCODE][0](&bro);
+		if (bro.b1 != b[i] && bad++ < 10)
+			printf("PCMU: batch encodes %a as %02X, per-sample %02X\n", s[i], b[i], bro.b1);
+	}
+
+	for (i = 0; i < N; i++)
+		b[i] = i < 256 ? (uint8_t)i : (uint8_t)rand();
+	dec_pcmu_batch(N, b, t);
+	for (i = 0; i < N; i++) {
+		bro.b1 = b[i];
+		pcmu_codec[DECODE][0](&bro);
+		d = bro.s;
+		if (memcmp(&d, &t[i], sizeof d) != 0 && bad++ < 10)
+			printf("PCMU: batch decodes %02X as %a, per-sample %a\n", b[i], t[i], d);
+	}
+	printf("Batch vs per-sample: %d mismatches in %d samples\n\n", bad, 2 * N);
+	return bad;
+}
+
+int
+main(void)
+{
+	pio_broker_t bro;
+	int i, bad;
+	
+	bad = check_special();
+	bad += check_batch();
+	srand(time(NULL));
+	
+	bro.s = 0.0;
+	bro.b1 = bro.b2 = bro.b3 = bro.b4 = 0;
+	
+#define info  (printf("PCMU: (Sound data: %f)\n", bro.s))
+#define print_enc  (printf("Encode: %02X\n", bro.b1))
+#define print_dec  (printf("Decode: %f\n", bro.s))
+#define show_codec {           \
+  info;                        \
+  pcmu_codec[ENCODE][0](&bro); \
+  print_enc;                   \
+  pcmu_codec[DECODE][0](&bro); \
+  print_dec;                   \
+  puts("");                    \
+}
+
+	printf("PCM mu-law Encoder/Decoder Test \n");
+	puts("");
+	
+	// random value
+	printf("Test for random value.\n");
+
+	for (i =0; i < 10; i++)
+	{
+		bro.s = GetRandom();
+		show_codec;
+	}
+	
+	return bad != 0;
+}
+
+double GetRandom(void)
+{
+	return 1.0 - (rand() / (double)RAND_MAX) * 2.0;
+}
+#endif /* ALGO_NO_MAIN */
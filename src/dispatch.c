@@ -0,0 +1,303 @@
+/*******************************************************************************
+	dispatch.c -- 配列版の実行時選択
+	SIMDのある配列版は，ライブラリでは同じソースを3通りに翻訳してある(Makefile)。
+	    xxx_base    -march=x86-64     SSE2まで (nnint.cのSSE4.1版も使わない)
+	    xxx_avx2    -march=x86-64-v3  AVX2, FMA
+	    xxx_avx512  -march=x86-64-v4  AVX-512F/BW/DQ/VL
+	公開名xxxは関数ポインタを通して呼ぶ。ポインタは初め選択関数を指しており，
+	最初の呼び出しでCPUを調べて書き換える。誰が書いても同じ値なので，
+	複数のスレッドから同時に呼ばれてもよい。
+	環境変数ALGO_ISA (base, avx2, avx512)で上限を下げられる。経路ごとの
+	結果や速度を比べるときに使う。
+*******************************************************************************/
+#include <stdlib.h> /* getenv() */
+#include <string.h> /* strcmp() */
+#include <stdatomic.h>
+#include "algomath.h"
+#include "pio.h"
+
+#define ISA_BASE   0
+#define ISA_AVX2   1
+#define ISA_AVX512 2
+
+/* 使える命令セットの段階 */
+static int
+algo_isa(void)
+{
+	const char *s = getenv("ALGO_ISA");
+	int isa = ISA_BASE, cap = ISA_AVX512;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("x86-64-v4"))
+		isa = ISA_AVX512;
+	else if (__builtin_cpu_supports("x86-64-v3"))
+		isa = ISA_AVX2;
+	if (s != NULL)
+	{
+		if (strcmp(s, "base") == 0)  cap = ISA_BASE;
+		else if (strcmp(s, "avx2") == 0)  cap = ISA_AVX2;
+	}
+	return isa < cap ? isa : cap;
+}
+
+/* nameの3つの版と，それを選ぶ公開名を作る。RETはreturnか空 */
+#define ALGO_DISPATCH(type, RET, name, params, args) \
+	type name##_base params; \
+	type name##_avx2 params; \
+	type name##_avx512 params; \
+	typedef type (*name##_fn) params; \
+	static type name##_select params; \
+	static _Atomic(name##_fn) name##_ptr = name##_select; \
+	static type \
+	name##_select params \
+	{ \
+		int isa = algo_isa(); \
+		name##_fn f = isa == ISA_AVX512 ? name##_avx512 : isa == ISA_AVX2 ? name##_avx2 : name##_base; \
+		atomic_store_explicit(&name##_ptr, f, memory_order_relaxed); \
+		RET f args; \
+	} \
+	type \
+	name params \
+	{ \
+		RET atomic_load_explicit(&name##_ptr, memory_order_relaxed) args; \
+	}
+
+/* loggamma.c */
+ALGO_DISPATCH(void, , loggamma_batch, (int len, const double *x, double *y), (len, x, y))
+
+/* nnint.c */
+ALGO_DISPATCH(int, return, nnint_round_array,
+              (int mode, int len, const double *x, double *y), (mode, len, x, y))
+ALGO_DISPATCH(int, return, nnint_round_arrayf,
+              (int mode, int len, const float *x, float *y), (mode, len, x, y))
+ALGO_DISPATCH(int, return, nnint_round_i32,
+              (int mode, int len, const double *x, int32_t *y), (mode, len, x, y))
+ALGO_DISPATCH(int, return, nnint_round_i64,
+              (int mode, int len, const double *x, int64_t *y), (mode, len, x, y))
+ALGO_DISPATCH(int, return, nnint_round_i32f,
+              (int mode, int len, const float *x, int32_t *y), (mode, len, x, y))
+ALGO_DISPATCH(int, return, nnint_round_i64f,
+              (int mode, int len, const float *x, int64_t *y), (mode, len, x, y))
+
+/* quadrant.c */
+ALGO_DISPATCH(void, , quadrant_batch,
+              (int len, const double *x, const double *y, double *out), (len, x, y, out))
+ALGO_DISPATCH(void, , quadrantf_batch,
+              (int len, const float *x, const float *y, float *out), (len, x, y, out))
+ALGO_DISPATCH(void, , cart2polar,
+              (const double *x, const double *y, double *r, double *theta, int n), (x, y, r, theta, n))
+ALGO_DISPATCH(void, , cart2polar_complex,
+              (const double *z, double *r, double *theta, int n), (z, r, theta, n))
+ALGO_DISPATCH(void, , polar2cart,
+              (const double *r, const double *theta, double *x, double *y, int n), (r, theta, x, y, n))
+ALGO_DISPATCH(void, , quadrant_classify_batch,
+              (int len, const double *x, const double *y, unsigned char *code), (len, x, y, code))
+/* 各版は同じ版のquadrant_classify_batchを呼ぶので，度数も版ごとに選ぶ */
+ALGO_DISPATCH(int, return, quadrant_histogram,
+              (const double *x, const double *y, int n, uint64_t counts[]), (x, y, n, counts))
+
+/* power.c */
+ALGO_DISPATCH(void, , powi_batch, (int len, const double *x, int n, double *y), (len, x, n, y))
+ALGO_DISPATCH(void, , pow_ratio_batch,
+              (int len, const double *x, int p, int q, double *out), (len, x, p, q, out))
+ALGO_DISPATCH(void, , pow_signed_batch,
+              (int len, const double *x, double y, double *out), (len, x, y, out))
+
+/* codec_pcm.c, codec_pcmu.c, codec_pcma.c */
+#define ALGO_DISPATCH_CODEC(name) \
+	ALGO_DISPATCH(void, , dec_##name##_batch, (int len, const uint8_t *b, double *s), (len, b, s)) \
+	ALGO_DISPATCH(void, , enc_##name##_batch, (int len, const double *s, uint8_t *b), (len, s, b))
+ALGO_DISPATCH_CODEC(pcm8bit)
+ALGO_DISPATCH_CODEC(pcm16bit)
+ALGO_DISPATCH_CODEC(pcm24bit)
+ALGO_DISPATCH_CODEC(pcm32bit)
+ALGO_DISPATCH_CODEC(pcmu)
+ALGO_DISPATCH_CODEC(pcma)
+
+
+/******************************************************************************/
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+// 以下はテスト: 版ごとの結果を基本版と比べる (libalgoc.aとリンクする)
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+
+#define LEN 4096
+
+static double xs[LEN], ys[LEN], out0[LEN], out1[LEN], out2[LEN], out3[LEN];
+static float xf[LEN], yf[LEN], of0[LEN], of1[LEN];
+static int64_t i0[LEN], i1[LEN], i2[LEN], i3[LEN];
+static int32_t n0[LEN], n1[LEN], n2[LEN], n3[LEN];
+static unsigned char c0[LEN], c1[LEN];
+static uint64_t h0[QUADRANT_NCODES], h1[QUADRANT_NCODES];
+static uint8_t b0[4 * LEN], b1[4 * LEN];
+
+/* 2つの倍精度の差を$\max(|a|, 1)$のulp単位で(bench.cのflooredと同じ)。
+ * 0の近く(loggamma(1)など)では絶対誤差で測ることになる。NaN同士は0 */
+static double
+ulps(double a, double b)
+{
+	if (a != a || b != b)
+		return (a != a && b != b) ? 0 : HUGE_VAL;
+	if (a == b)
+		return 0;
+	if (isinf(a) || isinf(b))
+		return HUGE_VAL;
+	return fabs(a - b) / (DBL_EPSILON * fmax(fabs(a), 1.0));
+}
+
+static double
+max_ulps(const double *a, const double *b, int n)
+{
+	double e, m = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+		if ((e = ulps(a[i], b[i])) > m)  m = e;
+	return m;
+}
+
+static int fails = 0;
+
+static void
+report(const char *name, const char *isa, double err, double tol)
+{
+	printf("  %-24s %-7s %8.3g%s\n", name, isa, err, err > tol ? "  NG" : "");
+	if (err > tol)  fails++;
+}
+
+/* 乱数と特殊な値 */
+static void
+fill(double lo, double hi)
+{
+	static const double sp[] = { 0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 2.5, -2.5,
+	                             HUGE_VAL, -HUGE_VAL, NAN, 1e-310, -1e-310, 1e300 };
+	int i;
+
+	srand(11);
+	for (i = 0; i < LEN; i++)
+	{
+		xs[i] = lo + (hi - lo) * rand() / RAND_MAX;
+		ys[i] = lo + (hi - lo) * rand() / RAND_MAX;
+	}
+	for (i = 0; i < (int)(sizeof sp / sizeof sp[0]); i++)
+	{
+		xs[i] = sp[i];
+		ys[i] = sp[(i + 3) % (int)(sizeof sp / sizeof sp[0])];
+		xs[LEN - 1 - i] = 3.0;  ys[LEN - 1 - i] = sp[i];
+	}
+	for (i = 0; i < LEN; i++)
+	{
+		xf[i] = (float)xs[i];
+		yf[i] = (float)ys[i];
+	}
+}
+
+/* 1要素のビット列が違えば1。丸めは$-0$とNaNまで同じでなければならない */
+#define DIFFERS(a, b, i)  (memcmp(&(a)[i], &(b)[i], sizeof (a)[i]) != 0)
+
+/* 1つの版の結果を基本版と比べる。浮動小数点はulp数，整数と丸めは食い違いの数。
+ * tolはSIMDの多項式近似とlibmとの違いの分 */
+static void
+check_isa(int isa)
+{
+	const char *s = isa == ISA_AVX512 ? "avx512" : "avx2";
+	int m, i, bad;
+
+#define PICK(name)  (isa == ISA_AVX512 ? name##_avx512 : name##_avx2)
+	fill(0.0, 200.0);
+	loggamma_batch_base(LEN, xs, out0);
+	PICK(loggamma_batch)(LEN, xs, out1);
+	report("loggamma_batch", s, max_ulps(out0, out1, LEN), 32);  /* loggamma.txt */
+
+	fill(-1e6, 1e6);
+	for (bad = m = 0; m <= NNINT_NEARBYINT; m++)
+	{
+		nnint_round_array_base(m, LEN, xs, out0);
+		PICK(nnint_round_array)(m, LEN, xs, out1);
+		nnint_round_arrayf_base(m, LEN, xf, of0);
+		PICK(nnint_round_arrayf)(m, LEN, xf, of1);
+		nnint_round_i64_base(m, LEN, xs, i0);
+		PICK(nnint_round_i64)(m, LEN, xs, i1);
+		nnint_round_i64f_base(m, LEN, xf, i2);
+		PICK(nnint_round_i64f)(m, LEN, xf, i3);
+		nnint_round_i32_base(m, LEN, xs, n0);
+		PICK(nnint_round_i32)(m, LEN, xs, n1);
+		nnint_round_i32f_base(m, LEN, xf, n2);
+		PICK(nnint_round_i32f)(m, LEN, xf, n3);
+		for (i = 0; i < LEN; i++)
+			bad += DIFFERS(out0, out1, i) || DIFFERS(of0, of1, i) ||
+			       DIFFERS(i0, i1, i) || DIFFERS(i2, i3, i) ||
+			       DIFFERS(n0, n1, i) || DIFFERS(n2, n3, i);
+	}
+	report("nnint_round_*", s, bad, 0);
+
+	fill(-10.0, 10.0);
+	quadrant_batch_base(LEN, xs, ys, out0);
+	PICK(quadrant_batch)(LEN, xs, ys, out1);
+	report("quadrant_batch", s, max_ulps(out0, out1, LEN), 4);
+	quadrantf_batch_base(LEN, xf, yf, of0);
+	PICK(quadrantf_batch)(LEN, xf, yf, of1);
+	for (bad = i = 0; i < LEN; i++)  /* 単精度は値の差で */
+		bad += !(of0[i] == of1[i] || (of0[i] != of0[i] && of1[i] != of1[i]) ||
+		         fabsf(of0[i] - of1[i]) <= 4 * FLT_EPSILON * fabsf(of0[i]));
+	report("quadrantf_batch", s, bad, 0);
+	cart2polar_base(xs, ys, out0, out2, LEN);
+	PICK(cart2polar)(xs, ys, out1, out3, LEN);
+	report("cart2polar", s, fmax(max_ulps(out0, out1, LEN), max_ulps(out2, out3, LEN)), 4);
+	polar2cart_base(xs, ys, out0, out2, LEN);
+	PICK(polar2cart)(xs, ys, out1, out3, LEN);
+	report("polar2cart", s, fmax(max_ulps(out0, out1, LEN), max_ulps(out2, out3, LEN)), 4);
+	quadrant_classify_batch_base(LEN, xs, ys, c0);
+	PICK(quadrant_classify_batch)(LEN, xs, ys, c1);
+	report("quadrant_classify_batch", s, memcmp(c0, c1, LEN) != 0, 0);
+	quadrant_histogram_base(xs, ys, LEN, h0);
+	PICK(quadrant_histogram)(xs, ys, LEN, h1);
+	report("quadrant_histogram", s, memcmp(h0, h1, sizeof h0) != 0, 0);
+
+	fill(-2.0, 2.0);
+	powi_batch_base(LEN, xs, 13, out0);
+	PICK(powi_batch)(LEN, xs, 13, out1);
+	report("powi_batch", s, max_ulps(out0, out1, LEN), 4);
+	pow_ratio_batch_base(LEN, xs, 2, 3, out0);
+	PICK(pow_ratio_batch)(LEN, xs, 2, 3, out1);
+	report("pow_ratio_batch", s, max_ulps(out0, out1, LEN), 4);
+	pow_ratio_batch_base(LEN, xs, 3, 2, out0);
+	PICK(pow_ratio_batch)(LEN, xs, 3, 2, out1);
+	report("pow_ratio_batch q=2", s, max_ulps(out0, out1, LEN), 4);
+	pow_signed_batch_base(LEN, xs, 1.0 / 3, out0);
+	PICK(pow_signed_batch)(LEN, xs, 1.0 / 3, out1);
+	report("pow_signed_batch", s, max_ulps(out0, out1, LEN), 4);
+
+	/* 符号化・復号は1ビットも違ってはならない */
+	fill(-1.5, 1.5);
+	for (i = 0; i < 4 * LEN; i++)
+		b0[i] = (uint8_t)rand();
+#define CODEC(name, width) \
+	enc_##name##_batch_base(LEN, xs, b0); \
+	PICK(enc_##name##_batch)(LEN, xs, b1); \
+	report("enc_" #name "_batch", s, memcmp(b0, b1, width * LEN) != 0, 0); \
+	dec_##name##_batch_base(LEN, b0, out0); \
+	PICK(dec_##name##_batch)(LEN, b0, out1); \
+	report("dec_" #name "_batch", s, memcmp(out0, out1, sizeof out0) != 0, 0);
+	CODEC(pcm8bit, 1)
+	CODEC(pcm16bit, 2)
+	CODEC(pcm24bit, 3)
+	CODEC(pcm32bit, 4)
+	CODEC(pcmu, 1)
+	CODEC(pcma, 1)
+#undef CODEC
+#undef PICK
+}
+
+int
+main(void)
+{
+	int isa = algo_isa();
+
+	printf("ISA: %s\n", isa == ISA_AVX512 ? "avx512" : isa == ISA_AVX2 ? "avx2" : "base");
+	if (isa >= ISA_AVX2)  check_isa(ISA_AVX2);
+	if (isa >= ISA_AVX512)  check_isa(ISA_AVX512);
+	return fails != 0;
+}
+#endif /* ALGO_NO_MAIN */
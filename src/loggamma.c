@@ -1,111 +1,817 @@
-/*******************************************************************************
-	gamma.c -- ガンマ関数
-	        -- ベータ関数
-	※奥村教授の事典の追補。第三版を出すらしく
-*******************************************************************************/
-#include <math.h>
-
-/*******************************************************************************
-Test Result:
-Prof. Okumura's source:
-----
-  x    LogGamma(x)
--5.5  -4.51783217400774
--4.5   nan
--3.5  -1.30900668499304
--2.5   nan
--1.5   0.86004701537648
--0.5   nan
- 0.5   0.5723649429247
- 1.0   0
- 2.0   0
- 3.0   0.693147180559944
- 4.0   1.79175946922805
- 5.0   3.17805383034795
-10.0   12.8018274800815
-15.0   25.1912211827387
-20.0   39.3398841871995
-25.0   54.7847293981123
-30.0   71.257038967168
-----
-
-modified (by p-adic logarithmic function):
-  x    LogGamma(x)
--5.5  -4.51783217400774
--4.5  -2.81308408176932
--3.5  -1.30900668499304
--2.5  -0.0562437164976757
--1.5   0.86004701537648
--0.5   1.26551212348464
- 0.5   0.5723649429247
- 1.0   0
- 2.0   0
- 3.0   0.693147180559944
- 4.0   1.79175946922805
- 5.0   3.17805383034795
-10.0   12.8018274800815
-15.0   25.1912211827387
-20.0   39.3398841871995
-25.0   54.7847293981123
-30.0   71.257038967168
-*******************************************************************************/
-
-#define PI      3.14159265358979324  /* $\pi$ */
-#define LOG_2PI 1.83787706640934548  /* $\log 2\pi$ */
-#define N       8
-
-#define B0  1                 /* 以下はBernoulli数 */
-#define B1  (-1.0 / 2.0)
-#define B2  ( 1.0 / 6.0)
-#define B4  (-1.0 / 30.0)
-#define B6  ( 1.0 / 42.0)
-#define B8  (-1.0 / 30.0)
-#define B10 ( 5.0 / 66.0)
-#define B12 (-691.0 / 2730.0)
-#define B14 ( 7.0 / 6.0)
-#define B16 (-3617.0 / 510.0)
-
-/* ガンマ関数の対数 */
-double
-loggamma(double x)
-{
-	double v, w;
-
-	v = 1;
-	while (x < N) {  v *= x;  x++;  }
-	w = 1 / (x * x);
-	return ((((((((B16 / (16 * 15))  * w + (B14 / (14 * 13))) * w
-	            + (B12 / (12 * 11))) * w + (B10 / (10 *  9))) * w
-	            + (B8  / ( 8 *  7))) * w + (B6  / ( 6 *  5))) * w
-	            + (B4  / ( 4 *  3))) * w + (B2  / ( 2 *  1))) / x
-	            + 0.5 * LOG_2PI - log(fabs(v)) - x + (x - 0.5) * log(fabs(x));
-}
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <float.h>
-
-int
-main(void)
-{
-	double x;
-
-	printf("  x    LogGamma(x)\n");
-	for (x = -5.5; x <= 0.51; x += 1.0)
-		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
-	for (x = 1; x <= 5.1; x += 1.0)
-		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
-	for (x = 10; x <= 30.1; x += 5.0)
-		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
-
-	puts("");
-
-	puts("Negative-integer's ComplexInfinity Check");
-	for (volatile int i = -5; i <= 0; i++)
-	{
-		x = i;
-		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
-	}
-
-	return 0;
-}
+/*******************************************************************************
+	gamma.c -- ガンマ関数
+	        -- ベータ関数
+	※奥村教授の事典の追補。第三版を出すらしく
+*******************************************************************************/
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "algomath.h"
+#include "probe.h"  /* -DALGO_PROBEのときだけ数える */
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#ifdef LOGGAMMA_QUAD  /* -DLOGGAMMA_QUAD -lquadmath */
+#include <quadmath.h>
+#endif
+
+/*******************************************************************************
+Test Result:
+Prof. Okumura's source:
+----
+  x    LogGamma(x)
+-5.5  -4.51783217400774
+-4.5   nan
+-3.5  -1.30900668499304
+-2.5   nan
+-1.5   0.86004701537648
+-0.5   nan
+ 0.5   0.5723649429247
+ 1.0   0
+ 2.0   0
+ 3.0   0.693147180559944
+ 4.0   1.79175946922805
+ 5.0   3.17805383034795
+10.0   12.8018274800815
+15.0   25.1912211827387
+20.0   39.3398841871995
+25.0   54.7847293981123
+30.0   71.257038967168
+----
+
+modified (by p-adic logarithmic function):
+  x    LogGamma(x)
+-5.5  -4.51783217400774
+-4.5  -2.81308408176932
+-3.5  -1.30900668499304
+-2.5  -0.0562437164976757
+-1.5   0.86004701537648
+-0.5   1.26551212348464
+ 0.5   0.5723649429247
+ 1.0   0
+ 2.0   0
+ 3.0   0.693147180559944
+ 4.0   1.79175946922805
+ 5.0   3.17805383034795
+10.0   12.8018274800815
+15.0   25.1912211827387
+20.0   39.3398841871995
+25.0   54.7847293981123
+30.0   71.257038967168
+*******************************************************************************/
+
+#define PI      3.14159265358979324  /* $\pi$ */
+#define LOG_2PI 1.83787706640934548  /* $\log 2\pi$ */
+#define N       8
+
+#define B0  1                 /* 以下はBernoulli数 */
+#define B1  (-1.0 / 2.0)
+#define B2  ( 1.0 / 6.0)
+#define B4  (-1.0 / 30.0)
+#define B6  ( 1.0 / 42.0)
+#define B8  (-1.0 / 30.0)
+#define B10 ( 5.0 / 66.0)
+#define B12 (-691.0 / 2730.0)
+#define B14 ( 7.0 / 6.0)
+#define B16 (-3617.0 / 510.0)
+
+/* ガンマ関数の対数 */
+double
+loggamma(double x)
+{
+	double v, w;
+
+	/* 相反公式 $\log|\Gamma(x)| = \log(\pi/|\sin\pi x|) - \log|\Gamma(1-x)|$
+	   $-N \leq x < N$は従来どおり高々2N回のずらしで済ませる */
+	if (x < -N)
+	{
+		w = x - floor(x);  /* $|\sin\pi x| = \sin\pi w$, $0 \leq w < 1$ */
+		PROBE_COUNT(PROBE_LOGGAMMA_REFLECT, 1);
+		if (w == 0)  return HUGE_VAL;  /* 負の整数では極 */
+		v = sin(PI * (w < 0.5 ? w : 1 - w));
+		return log(PI / v) - loggamma(1 - x);
+	}
+	v = 1;
+	PROBE_COUNT(x < N ? PROBE_LOGGAMMA_SHIFT : PROBE_LOGGAMMA, 1);
+	while (x < N) {  v *= x;  x++;  }
+	w = 1 / (x * x);
+	return ((((((((B16 / (16 * 15))  * w + (B14 / (14 * 13))) * w
+	            + (B12 / (12 * 11))) * w + (B10 / (10 *  9))) * w
+	            + (B8  / ( 8 *  7))) * w + (B6  / ( 6 *  5))) * w
+	            + (B4  / ( 4 *  3))) * w + (B2  / ( 2 *  1))) / x
+	            + 0.5 * LOG_2PI - log(fabs(v)) - x + (x - 0.5) * log(fabs(x));
+}
+
+/*******************************************************************************
+	配列版 loggamma_batch()
+	$x \geq$ DBL_MINの有限値はベクトルで求める。ずらしはwhileではなく，
+	マスクつきでN回固定で回す(スカラー版と同じ乗算の列になる)。漸近展開の
+	Hornerもベクトルのまま評価し，対数はfdlibmと同じ多項式のベクトル版を使う。
+	それ以外(負・0・非正規・無限大・NaN)を含むベクトルはスカラー版に回す。
+*******************************************************************************/
+#define LG_LN2_HI  6.93147180369123816490e-01  /* 以下はfdlibmのlog()の係数 */
+#define LG_LN2_LO  1.90821492927058770002e-10
+#define LG_L1      6.666666666666735130e-01
+#define LG_L2      3.999999999940941908e-01
+#define LG_L3      2.857142874366239149e-01
+#define LG_L4      2.222219843214978396e-01
+#define LG_L5      1.818357216161805012e-01
+#define LG_L6      1.531383769920937332e-01
+#define LG_L7      1.479819860511658591e-01
+#define LG_SQRT2   1.41421356237309504880
+
+#if defined(__AVX512F__)
+#define LG_VLEN 8
+typedef __m512d lg_vec_t;
+#define lg_set1(a)      _mm512_set1_pd(a)
+#define lg_add(a, b)    _mm512_add_pd(a, b)
+#define lg_sub(a, b)    _mm512_sub_pd(a, b)
+#define lg_mul(a, b)    _mm512_mul_pd(a, b)
+#define lg_div(a, b)    _mm512_div_pd(a, b)
+#define lg_load(p)      _mm512_loadu_pd(p)
+#define lg_store(p, a)  _mm512_storeu_pd(p, a)
+
+/* 正の正規数の対数: $x = 2^{k}m$, $\sqrt{2}/2 \leq m < \sqrt{2}$ */
+static inline lg_vec_t
+lg_log(lg_vec_t x)
+{
+	lg_vec_t m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+	lg_vec_t k = _mm512_getexp_pd(x);
+	__mmask8 big = _mm512_cmp_pd_mask(m, lg_set1(LG_SQRT2), _CMP_GT_OQ);
+	lg_vec_t f, s, z, r, hfsq;
+
+	m = _mm512_mask_mul_pd(m, big, m, lg_set1(0.5));
+	k = _mm512_mask_add_pd(k, big, k, lg_set1(1.0));
+	f = lg_sub(m, lg_set1(1.0));
+	s = lg_div(f, lg_add(lg_set1(2.0), f));
+	z = lg_mul(s, s);
+	r = lg_add(lg_mul(z, lg_set1(LG_L7)), lg_set1(LG_L6));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L5));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L4));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L3));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L2));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L1));
+	r = lg_mul(z, r);
+	hfsq = lg_mul(lg_set1(0.5), lg_mul(f, f));
+	return lg_sub(lg_mul(k, lg_set1(LG_LN2_HI)),
+	              lg_sub(lg_sub(hfsq, lg_add(lg_mul(s, lg_add(hfsq, r)),
+	                                         lg_mul(k, lg_set1(LG_LN2_LO)))), f));
+}
+
+/* 全レーンがDBL_MIN以上の有限値か */
+static inline int
+lg_all_normal(lg_vec_t x)
+{
+	return _mm512_cmp_pd_mask(x, lg_set1(DBL_MIN), _CMP_GE_OQ)
+	     & _mm512_cmp_pd_mask(x, lg_set1(HUGE_VAL), _CMP_LT_OQ);
+}
+#define LG_ALL_LANES 0xFF
+
+/* マスクつきのずらし: x < Nのレーンだけ v *= x, x++ */
+static inline void
+lg_shift(lg_vec_t *x, lg_vec_t *v)
+{
+	__mmask8 lt = _mm512_cmp_pd_mask(*x, lg_set1(N), _CMP_LT_OQ);
+
+	*v = _mm512_mask_mul_pd(*v, lt, *v, *x);
+	*x = _mm512_mask_add_pd(*x, lt, *x, lg_set1(1.0));
+}
+
+#elif defined(__AVX2__)
+#define LG_VLEN 4
+typedef __m256d lg_vec_t;
+#define lg_set1(a)      _mm256_set1_pd(a)
+#define lg_add(a, b)    _mm256_add_pd(a, b)
+#define lg_sub(a, b)    _mm256_sub_pd(a, b)
+#define lg_mul(a, b)    _mm256_mul_pd(a, b)
+#define lg_div(a, b)    _mm256_div_pd(a, b)
+#define lg_load(p)      _mm256_loadu_pd(p)
+#define lg_store(p, a)  _mm256_storeu_pd(p, a)
+
+static inline lg_vec_t
+lg_log(lg_vec_t x)
+{
+	const __m256i bits = _mm256_castpd_si256(x);
+	/* 指数部はそのまま$2^{52}$の仮数に埋めて倍精度に直す */
+	const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+	__m256i e = _mm256_or_si256(_mm256_srli_epi64(bits, 52), magic);
+	lg_vec_t k = lg_sub(_mm256_castsi256_pd(e), lg_set1(4503599627370496.0 + 1023));
+	lg_vec_t m = _mm256_castsi256_pd(_mm256_or_si256(
+	    _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+	    _mm256_set1_epi64x(0x3FF0000000000000LL)));
+	lg_vec_t big = _mm256_cmp_pd(m, lg_set1(LG_SQRT2), _CMP_GT_OQ);
+	lg_vec_t f, s, z, r, hfsq;
+
+	m = _mm256_blendv_pd(m, lg_mul(m, lg_set1(0.5)), big);
+	k = _mm256_blendv_pd(k, lg_add(k, lg_set1(1.0)), big);
+	f = lg_sub(m, lg_set1(1.0));
+	s = lg_div(f, lg_add(lg_set1(2.0), f));
+	z = lg_mul(s, s);
+	r = lg_add(lg_mul(z, lg_set1(LG_L7)), lg_set1(LG_L6));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L5));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L4));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L3));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L2));
+	r = lg_add(lg_mul(z, r), lg_set1(LG_L1));
+	r = lg_mul(z, r);
+	hfsq = lg_mul(lg_set1(0.5), lg_mul(f, f));
+	return lg_sub(lg_mul(k, lg_set1(LG_LN2_HI)),
+	              lg_sub(lg_sub(hfsq, lg_add(lg_mul(s, lg_add(hfsq, r)),
+	                                         lg_mul(k, lg_set1(LG_LN2_LO)))), f));
+}
+
+static inline int
+lg_all_normal(lg_vec_t x)
+{
+	return _mm256_movemask_pd(_mm256_and_pd(
+	    _mm256_cmp_pd(x, lg_set1(DBL_MIN), _CMP_GE_OQ),
+	    _mm256_cmp_pd(x, lg_set1(HUGE_VAL), _CMP_LT_OQ)));
+}
+#define LG_ALL_LANES 0xF
+
+static inline void
+lg_shift(lg_vec_t *x, lg_vec_t *v)
+{
+	lg_vec_t lt = _mm256_cmp_pd(*x, lg_set1(N), _CMP_LT_OQ);
+
+	*v = _mm256_blendv_pd(*v, lg_mul(*v, *x), lt);
+	*x = _mm256_blendv_pd(*x, lg_add(*x, lg_set1(1.0)), lt);
+}
+#endif
+
+#ifdef LG_VLEN
+/* ベクトル1本分の$\log\Gamma(x)$ */
+static inline lg_vec_t
+lg_kernel(lg_vec_t x)
+{
+	lg_vec_t v = lg_set1(1.0), w, r;
+	int i;
+
+	for (i = 0; i < N; i++)  /* 分岐なしでN回 */
+		lg_shift(&x, &v);
+	w = lg_div(lg_set1(1.0), lg_mul(x, x));
+	r = lg_add(lg_mul(lg_set1(B16 / (16 * 15)), w), lg_set1(B14 / (14 * 13)));
+	r = lg_add(lg_mul(r, w), lg_set1(B12 / (12 * 11)));
+	r = lg_add(lg_mul(r, w), lg_set1(B10 / (10 *  9)));
+	r = lg_add(lg_mul(r, w), lg_set1(B8  / ( 8 *  7)));
+	r = lg_add(lg_mul(r, w), lg_set1(B6  / ( 6 *  5)));
+	r = lg_add(lg_mul(r, w), lg_set1(B4  / ( 4 *  3)));
+	r = lg_add(lg_mul(r, w), lg_set1(B2  / ( 2 *  1)));
+	r = lg_add(lg_div(r, x), lg_set1(0.5 * LOG_2PI));
+	r = lg_sub(r, lg_log(v));
+	r = lg_sub(r, x);
+	return lg_add(r, lg_mul(lg_sub(x, lg_set1(0.5)), lg_log(x)));
+}
+#endif
+
+/* ガンマ関数の対数の配列版 y[i] = loggamma(x[i]) */
+void
+loggamma_batch(int len, const double *x, double *y)
+{
+	int i = 0, j;
+	PROBE_TIMER_START(t0, PROBE_T_LOGGAMMA_BATCH);
+
+	PROBE_COUNT(PROBE_LOGGAMMA_BATCH, len);
+#ifdef LG_VLEN
+	for (; i + LG_VLEN <= len; i += LG_VLEN)
+	{
+		lg_vec_t vx = lg_load(x + i);
+
+		if (lg_all_normal(vx) == LG_ALL_LANES)
+			lg_store(y + i, lg_kernel(vx));
+		else
+			for (j = i; j < i + LG_VLEN; j++)
+				y[j] = loggamma(x[j]);
+	}
+#endif
+	for (j = i; j < len; j++)
+		y[j] = loggamma(x[j]);
+	PROBE_TIMER_STOP(t0, PROBE_T_LOGGAMMA_BATCH);
+}
+
+/*******************************************************************************
+	ベータ関数
+	$\log B(a, b) = \log\Gamma(a) + \log\Gamma(b) - \log\Gamma(a+b)$をそのまま
+	求めると，a, bが大きいとき大きな数同士の引き算になり桁落ちする。
+	Stirlingの式の主要部を$\log(p/(p+q))$, $\log(1-p/(p+q))$の形にまとめ，
+	残りの補正項$\delta(x) = \log\Gamma(x) - (x-\frac{1}{2})\log x + x - \frac{1}{2}\log 2\pi$
+	はp, q, p+qの3つを1本のHornerの流れでまとめて求める。
+*******************************************************************************/
+static const double lg_stirling[8] =
+{
+	B16 / (16 * 15), B14 / (14 * 13), B12 / (12 * 11), B10 / (10 *  9),
+	B8  / ( 8 *  7), B6  / ( 6 *  5), B4  / ( 4 *  3), B2  / ( 2 *  1)
+};
+
+/* $\delta(p) + \delta(q) - \delta(p+q)$ (withp = 0なら$\delta(p)$を除く) */
+static double
+lbeta_corr(double p, double q, int withp)
+{
+	double s = p + q;
+	double wp = 1 / (p * p), wq = 1 / (q * q), ws = 1 / (s * s);
+	double rp = 0, rq = 0, rs = 0;
+	int i;
+
+	for (i = 0; i < 8; i++)
+	{
+		rp = rp * wp + lg_stirling[i];
+		rq = rq * wq + lg_stirling[i];
+		rs = rs * ws + lg_stirling[i];
+	}
+	return (withp ? rp / p : 0) + rq / q - rs / s;
+}
+
+/* ガンマ関数の符号 */
+static double
+lg_gamma_sign(double x)
+{
+	if (x > 0)  return 1;
+	return fmod(floor(x), 2) != 0 ? -1 : 1;
+}
+
+/* ベータ関数の対数 $\log|B(a, b)|$ */
+double
+lbeta(double a, double b)
+{
+	double p = a < b ? a : b, q = a < b ? b : a;  /* $p \leq q$ */
+
+	if (p != p || q != q)  return p + q;  /* NaNを素通りさせる */
+	if (p <= 0)  /* 負の側は定義どおりに */
+		return loggamma(p) + loggamma(q) - loggamma(p + q);
+	if (q == HUGE_VAL)  return -HUGE_VAL;
+	if (p >= N)  /* 両方とも大きい */
+		return -0.5 * log(q) + 0.5 * LOG_2PI + lbeta_corr(p, q, 1)
+		     + (p - 0.5) * log(p / (p + q)) + q * log1p(-p / (p + q));
+	if (q >= N)  /* 片方だけ大きい */
+		return loggamma(p) + lbeta_corr(p, q, 0)
+		     + p - p * log(p + q) + (q - 0.5) * log1p(-p / (p + q));
+	return loggamma(p) + loggamma(q) - loggamma(p + q);
+}
+
+/* ベータ関数 $B(a, b)$ */
+double
+beta(double a, double b)
+{
+	double v = exp(lbeta(a, b));
+
+	if (a > 0 && b > 0)  return v;
+	return lg_gamma_sign(a) * lg_gamma_sign(b) * lg_gamma_sign(a + b) * v;
+}
+
+/* 配列版 */
+void
+lbeta_batch(int len, const double *a, const double *b, double *y)
+{
+	for (int i = 0; i < len; i++)
+		y[i] = lbeta(a[i], b[i]);
+}
+
+void
+beta_batch(int len, const double *a, const double *b, double *y)
+{
+	for (int i = 0; i < len; i++)
+		y[i] = beta(a[i], b[i]);
+}
+
+/*******************************************************************************
+	ガンマ関数の対数・ディガンマ関数・トリガンマ関数
+	ずらし $x \to x+1$ の間に$v \gets vx$, $\psi \gets \psi - 1/x$, $\psi' \gets \psi' + 1/x^2$を
+	同時に積み，漸近展開も$w = 1/x^2$の同じ冪で3本のHornerを並べて回す。
+	対数も$\log x$の1回で済ませる ($\log v$は$\log\Gamma$だけが使う)。
+	$\log\Gamma(x) \sim (x-\frac{1}{2})\log x - x + \frac{1}{2}\log 2\pi + \sum B_{2k}/(2k(2k-1)x^{2k-1})$
+	$\psi(x) \sim \log x - 1/(2x) - \sum B_{2k}/(2k x^{2k})$
+	$\psi'(x) \sim 1/x + 1/(2x^2) + \sum B_{2k}/x^{2k+1}$
+*******************************************************************************/
+static const double lg_bernoulli[8] =
+{
+	B16, B14, B12, B10, B8, B6, B4, B2
+};
+static const double lg_psi_coef[8] =
+{
+	B16 / 16, B14 / 14, B12 / 12, B10 / 10, B8 / 8, B6 / 6, B4 / 4, B2 / 2
+};
+
+void
+loggamma_psi(double x, double *lg, double *psi, double *psi1)
+{
+	double v, w, r0, r1, r2, lx, d, t;
+	int i;
+
+	if (x <= 0 && x == floor(x))  /* 極 */
+	{
+		*lg = HUGE_VAL;  *psi = NAN;  *psi1 = HUGE_VAL;
+		return;
+	}
+	if (x < -N)  /* 相反公式 */
+	{
+		w = x - floor(x);
+		t = PI * (w < 0.5 ? w : 1 - w);
+		loggamma_psi(1 - x, lg, psi, psi1);
+		*lg = log(PI / sin(t)) - *lg;
+		*psi -= PI / tan(PI * (w <= 0.5 ? w : w - 1));  /* $\psi(x) = \psi(1-x) - \pi\cot\pi x$ */
+		*psi1 = PI * PI / (sin(t) * sin(t)) - *psi1;  /* $\psi'(x) = \pi^2/\sin^2\pi x - \psi'(1-x)$ */
+		return;
+	}
+	v = 1;  r1 = r2 = 0;
+	while (x < N)
+	{
+		d = 1 / x;
+		v *= x;  r1 -= d;  r2 += d * d;
+		x++;
+	}
+	*psi = r1;  *psi1 = r2;
+	d = 1 / x;
+	w = d * d;
+	r0 = r1 = r2 = 0;
+	for (i = 0; i < 8; i++)
+	{
+		r0 = r0 * w + lg_stirling[i];
+		r1 = r1 * w + lg_psi_coef[i];
+		r2 = r2 * w + lg_bernoulli[i];
+	}
+	lx = log(x);
+	*lg = r0 * d + 0.5 * LOG_2PI - log(fabs(v)) - x + (x - 0.5) * lx;
+	*psi += lx - 0.5 * d - r1 * w;
+	*psi1 += d + 0.5 * w + r2 * w * d;
+}
+
+/* 配列版 */
+void
+loggamma_psi_batch(int len, const double *x, double *lg, double *psi, double *psi1)
+{
+	for (int i = 0; i < len; i++)
+		loggamma_psi(x[i], &lg[i], &psi[i], &psi1[i]);
+}
+
+/* 単独のディガンマ関数 $\psi(x)$ */
+double
+digamma(double x)
+{
+	double r, w, d;
+
+	if (x <= 0 && x == floor(x))  return NAN;
+	if (x < -N)
+	{
+		/* $\cot$の周期で$w - 1 \in [-1/2, 0)$に寄せる。$\pi w$が$\pi$に近いと
+		   $\pi$の丸め誤差がそのまま$\tan$の相対誤差になる($w - 1$は正確) */
+		w = x - floor(x);
+		return digamma(1 - x) - PI / tan(PI * (w <= 0.5 ? w : w - 1));
+	}
+	r = 0;
+	while (x < N) {  r -= 1 / x;  x++;  }
+	d = 1 / x;  w = d * d;
+	return r + log(x) - 0.5 * d
+	       - ((((((((B16 / 16) * w + B14 / 14) * w + B12 / 12) * w + B10 / 10) * w
+	            + B8 / 8) * w + B6 / 6) * w + B4 / 4) * w + B2 / 2) * w;
+}
+
+/* 単独のトリガンマ関数 $\psi'(x)$ */
+double
+trigamma(double x)
+{
+	double r, w, d, t;
+
+	if (x <= 0 && x == floor(x))  return HUGE_VAL;
+	if (x < -N)
+	{
+		w = x - floor(x);
+		t = sin(PI * (w < 0.5 ? w : 1 - w));
+		return PI * PI / (t * t) - trigamma(1 - x);
+	}
+	r = 0;
+	while (x < N) {  r += 1 / (x * x);  x++;  }
+	d = 1 / x;  w = d * d;
+	return r + d + 0.5 * w
+	       + (((((((B16 * w + B14) * w + B12) * w + B10) * w
+	            + B8) * w + B6) * w + B4) * w + B2) * w * d;
+}
+
+/*******************************************************************************
+	精度別のloggamma
+	漸近展開の打ち切り誤差はおよそ次の項 $|B_{2k+2}|/((2k+2)(2k+1)N^{2k+1})$ で，
+	ずらしの閾値Nと項数を型の精度に合わせて選ぶ。
+	  float        N =  5, $B_2$..$B_6$   (打ち切り誤差 $8\times 10^{-9}$)
+	  double       N =  8, $B_2$..$B_{16}$ (loggamma)
+	  long double  N = 16, $B_2$..$B_{20}$ ($2\times 10^{-23}$)
+	  __float128   N = 24, $B_2$..$B_{30}$ ($3\times 10^{-36}$)
+*******************************************************************************/
+#define NF  5
+#define NL  16
+
+/* 単精度 */
+float
+loggammaf(float x)
+{
+	float v, w;
+
+	if (x < -NF)
+	{
+		w = x - floorf(x);
+		if (w == 0)  return HUGE_VALF;
+		v = sinf((float)PI * (w < 0.5f ? w : 1 - w));
+		return logf((float)PI / v) - loggammaf(1 - x);
+	}
+	v = 1;
+	while (x < NF) {  v *= x;  x++;  }
+	w = 1 / (x * x);
+	return (((float)(B6 / (6 * 5)) * w + (float)(B4 / (4 * 3))) * w
+	        + (float)(B2 / (2 * 1))) / x
+	        + (float)(0.5 * LOG_2PI) - logf(fabsf(v)) - x + (x - 0.5f) * logf(fabsf(x));
+}
+
+/* 拡張倍精度 */
+#define PI_L       3.14159265358979323846264338327950288L
+#define LOG_2PI_L  1.83787706640934548356065947281123527L
+
+long double
+loggammal(long double x)
+{
+	static const long double c[10] =
+	{
+		(-174611.0L / 330.0L) / (20 * 19), (43867.0L / 798.0L) / (18 * 17),
+		(-3617.0L / 510.0L) / (16 * 15), (7.0L / 6.0L) / (14 * 13),
+		(-691.0L / 2730.0L) / (12 * 11), (5.0L / 66.0L) / (10 * 9),
+		(-1.0L / 30.0L) / (8 * 7), (1.0L / 42.0L) / (6 * 5),
+		(-1.0L / 30.0L) / (4 * 3), (1.0L / 6.0L) / (2 * 1)
+	};
+	long double v, w, r;
+	int i;
+
+	if (x < -NL)
+	{
+		w = x - floorl(x);
+		if (w == 0)  return HUGE_VALL;
+		v = sinl(PI_L * (w < 0.5L ? w : 1 - w));
+		return logl(PI_L / v) - loggammal(1 - x);
+	}
+	v = 1;
+	while (x < NL) {  v *= x;  x++;  }
+	w = 1 / (x * x);
+	for (r = 0, i = 0; i < 10; i++)
+		r = r * w + c[i];
+	return r / x + 0.5L * LOG_2PI_L - logl(fabsl(v)) - x + (x - 0.5L) * logl(fabsl(x));
+}
+
+#ifdef LOGGAMMA_QUAD
+/* 四倍精度 (参照用) */
+#define NQ 24
+
+__float128
+loggammaq(__float128 x)
+{
+	static const __float128 c[15] =
+	{
+		(8615841276005.0Q / 14322.0Q) / (30 * 29), (-23749461029.0Q / 870.0Q) / (28 * 27),
+		(8553103.0Q / 6.0Q) / (26 * 25), (-236364091.0Q / 2730.0Q) / (24 * 23),
+		(854513.0Q / 138.0Q) / (22 * 21), (-174611.0Q / 330.0Q) / (20 * 19),
+		(43867.0Q / 798.0Q) / (18 * 17), (-3617.0Q / 510.0Q) / (16 * 15),
+		(7.0Q / 6.0Q) / (14 * 13), (-691.0Q / 2730.0Q) / (12 * 11),
+		(5.0Q / 66.0Q) / (10 * 9), (-1.0Q / 30.0Q) / (8 * 7),
+		(1.0Q / 42.0Q) / (6 * 5), (-1.0Q / 30.0Q) / (4 * 3), (1.0Q / 6.0Q) / (2 * 1)
+	};
+	__float128 v, w, r;
+	int i;
+
+	if (x < -NQ)
+	{
+		w = x - floorq(x);
+		if (w == 0)  return HUGE_VALQ;
+		v = sinq(M_PIq * (w < 0.5Q ? w : 1 - w));
+		return logq(M_PIq / v) - loggammaq(1 - x);
+	}
+	v = 1;
+	while (x < NQ) {  v *= x;  x++;  }
+	w = 1 / (x * x);
+	for (r = 0, i = 0; i < 15; i++)
+		r = r * w + c[i];
+	return r / x + 0.5Q * logq(2 * M_PIq) - logq(fabsq(v)) - x + (x - 0.5Q) * logq(fabsq(x));
+}
+#endif
+
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int
+main(void)
+{
+	double x;
+	int bad = 0;
+
+	printf("  x    LogGamma(x)\n");
+	for (x = -5.5; x <= 0.51; x += 1.0)
+		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
+	for (x = 1; x <= 5.1; x += 1.0)
+		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
+	for (x = 10; x <= 30.1; x += 5.0)
+		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
+
+	puts("");
+
+	puts("Negative-integer's ComplexInfinity Check");
+	for (volatile int i = -5; i <= 0; i++)
+	{
+		x = i;
+		printf("%4.1f  % .*g\n", x, DBL_DIG, loggamma(x));
+	}
+
+	puts("");
+
+	puts("Large negative arguments (reflection formula)");
+	for (x = -10.25; x >= -1.1e6; x = x * 10 + 2.25)
+		printf("%-11.2f % .*g  lgamma: % .*g\n", x, DBL_DIG, loggamma(x), DBL_DIG, lgamma(x));
+	{
+		clock_t c0, c1;
+		volatile double sink = 0;
+		int i;
+
+		c0 = clock();
+		for (i = 0; i < 1000000; i++)
+			sink += loggamma(-1e6 - i - 0.25);
+		c1 = clock();
+		printf("loggamma(x < -1e6): %.1f ns/call\n", 1e9 * (c1 - c0) / CLOCKS_PER_SEC / 1000000);
+	}
+
+	puts("");
+
+	puts("LogBeta(a, b): lbeta vs loggamma(a)+loggamma(b)-loggamma(a+b), reference lgammal");
+	{
+		static const double ab[][2] =
+		{
+			{ 0.5, 0.5 }, { 2, 3 }, { 3.5, 20 }, { 1e3, 1e3 },
+			{ 1e6, 2.5 }, { 1e8, 1e8 }, { 1e12, 3e12 }, { -2.5, 1.25 }
+		};
+		int i;
+
+		for (i = 0; i < (int)(sizeof ab / sizeof ab[0]); i++)
+		{
+			double a = ab[i][0], b = ab[i][1];
+			long double r = lgammal(a) + lgammal(b) - lgammal((long double)a + b);
+
+			printf("(%g, %g)  % .*g  % .*g  ref % .*Lg\n", a, b, DBL_DIG, lbeta(a, b),
+			       DBL_DIG, loggamma(a) + loggamma(b) - loggamma(a + b), DBL_DIG, r);
+		}
+		printf("B(2, 3) = %g, B(-0.5, 2) = %g\n", beta(2, 3), beta(-0.5, 2));
+	}
+
+	puts("");
+
+	puts("loggamma_psi: log Gamma, digamma, trigamma");
+	{
+		static const double xs[] = { -10.5, -7.5, -0.5, 0.5, 1, 2.5, 10, 100 };
+		double lg, psi, psi1;
+		enum { LEN = 1 << 20 };
+		static double bx[LEN], b0[LEN], b1[LEN], b2[LEN];
+		volatile double sink = 0;
+		clock_t c0, c1, c2;
+		int i;
+
+		for (i = 0; i < (int)(sizeof xs / sizeof xs[0]); i++)
+		{
+			loggamma_psi(xs[i], &lg, &psi, &psi1);
+			printf("%6.1f  % .*g  % .*g  % .*g\n", xs[i],
+			       DBL_DIG, lg, DBL_DIG, psi, DBL_DIG, psi1);
+		}
+		for (i = 0; i < LEN; i++)
+			bx[i] = 0.01 + 50.0 * i / LEN;
+		loggamma_psi_batch(LEN, bx, b0, b1, b2);  /* 空回し */
+		c0 = clock();
+		for (i = 0; i < LEN; i++)
+			sink += loggamma(bx[i]) + digamma(bx[i]) + trigamma(bx[i]);
+		c1 = clock();
+		loggamma_psi_batch(LEN, bx, b0, b1, b2);
+		c2 = clock();
+		printf("separate %.2f ns/point, fused %.2f ns/point\n",
+		       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN);
+	}
+
+	puts("");
+
+	puts("digamma near negative integers: relative error vs long double cot");
+	{
+		/* 整数の両側。$\psi(1-x)$は正の側なのでdoubleのまま使い，$\pi\cot\pi x$だけlong doubleで */
+		static const double xs[] =
+		{
+			-3.0000001, -2.9999999, -9.00001, -8.99999,
+			-100000.0000001, -99999.9999999, -1e6 - 1e-6, -1e6 + 1e-6
+		};
+		const long double pil = 3.141592653589793238462643383279502884L;
+		double lg, psi, psi1, e, ed, ep;
+		long double w, ref;
+		int i;
+
+		for (i = 0; i < (int)(sizeof xs / sizeof xs[0]); i++)
+		{
+			w = xs[i] - floor(xs[i]);
+			ref = digamma(1 - xs[i]) - pil / tanl(pil * (w <= 0.5 ? w : w - 1));
+			loggamma_psi(xs[i], &lg, &psi, &psi1);
+			ed = fabsl(digamma(xs[i]) - ref) / fabsl(ref);
+			ep = fabsl(psi - ref) / fabsl(ref);
+			e = ed > ep ? ed : ep;
+			printf("%-16.8f % .*g  %.1e%s\n", xs[i], DBL_DIG, digamma(xs[i]), e,
+			       e < 8 * DBL_EPSILON ? "" : "  NG");
+			bad += !(e < 8 * DBL_EPSILON);
+		}
+	}
+
+	puts("");
+
+	puts("loggammaf / loggamma / loggammal: accuracy and speed on (0, 100]");
+	{
+		enum { LEN = 1 << 18 };
+		static double xd[LEN];
+		static float xf[LEN];
+		static long double xl[LEN], ref[LEN];
+		double ef = 0, ed = 0, el = 0, e, m;
+		volatile float sf = 0;
+		volatile double sd = 0;
+		volatile long double sl = 0;
+		clock_t c0, c1, c2, c3;
+		int i;
+
+		for (i = 0; i < LEN; i++)
+		{
+			xf[i] = (float)(100.0 * (i + 1) / LEN);
+			xd[i] = xl[i] = xf[i];  /* 3つの型で同じ点 */
+#ifdef LOGGAMMA_QUAD
+			ref[i] = (long double)lgammaq(xf[i]);
+#else
+			ref[i] = lgammal(xl[i]);
+#endif
+		}
+		for (i = 0; i < LEN; i++)
+		{
+			m = fabsl(ref[i]) > 1 ? fabsl(ref[i]) : 1;  /* ulp(max(|f|, 1))で測る */
+			e = fabsl(loggammaf(xf[i]) - ref[i]) / (m * FLT_EPSILON);  if (e > ef)  ef = e;
+			e = fabsl(loggamma(xd[i]) - ref[i]) / (m * DBL_EPSILON);  if (e > ed)  ed = e;
+			e = fabsl(loggammal(xl[i]) - ref[i]) / (m * LDBL_EPSILON);  if (e > el)  el = e;
+		}
+		c0 = clock();
+		for (i = 0; i < LEN; i++)  sf += loggammaf(xf[i]);
+		c1 = clock();
+		for (i = 0; i < LEN; i++)  sd += loggamma(xd[i]);
+		c2 = clock();
+		for (i = 0; i < LEN; i++)  sl += loggammal(xl[i]);
+		c3 = clock();
+		printf("float       max %6.2f ulp  %6.2f ns/call\n", ef, 1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN);
+		printf("double      max %6.2f ulp  %6.2f ns/call\n", ed, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN);
+		printf("long double max %6.2f ulp  %6.2f ns/call%s\n", el, 1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN,
+#ifdef LOGGAMMA_QUAD
+		       " (vs __float128)"
+#else
+		       " (vs lgammal)"
+#endif
+		       );
+	}
+
+	puts("");
+
+	puts("loggamma_batch: error in ulp(max(|f|, 1)) over dense and random domains");
+	{
+		enum { LEN = 1 << 20 };
+		static double xs[LEN], ys[LEN];
+		double us, ul, ms = 0, ml = 0, ss = 0, sl = 0;
+		clock_t c0, c1, c2;
+		volatile double sink = 0;
+		int i;
+
+		srand(1);
+		for (i = 0; i < LEN / 2; i++)  /* 密: (0, 64] */
+			xs[i] = 64.0 * (i + 1) / (LEN / 2);
+		for (; i < LEN; i++)           /* 乱: $2^{-20}$から$2^{40}$まで対数一様 */
+			xs[i] = ldexp(1.0 + rand() / (RAND_MAX + 1.0), rand() % 60 - 20);
+		loggamma_batch(LEN, xs, ys);
+		for (i = 0; i < LEN; i++)
+		{
+			double s = loggamma(xs[i]), l = lgamma(xs[i]);
+
+			/* 零点x = 1, 2の近くは桁落ちするので，|f| < 1ではulp(1)で測る */
+			s = fabs(s) > 1 ? fabs(s) : 1;  l = fabs(l) > 1 ? fabs(l) : 1;
+			us = fabs(ys[i] - loggamma(xs[i])) / (nextafter(s, HUGE_VAL) - s);
+			ul = fabs(ys[i] - lgamma(xs[i])) / (nextafter(l, HUGE_VAL) - l);
+			if (us > ms)  ms = us;
+			if (ul > ml)  ml = ul;
+			ss += us;  sl += ul;
+		}
+		printf("vs loggamma: max %.2f ulp, mean %.3f ulp\n", ms, ss / LEN);
+		printf("vs lgamma:   max %.2f ulp, mean %.3f ulp\n", ml, sl / LEN);
+		c0 = clock();
+		for (i = 0; i < LEN; i++)
+			sink += loggamma(xs[i]);
+		c1 = clock();
+		loggamma_batch(LEN, xs, ys);
+		c2 = clock();
+		printf("scalar %.2f ns/call, batch %.2f ns/call (%d lanes)\n",
+		       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN,
+#ifdef LG_VLEN
+		       LG_VLEN
+#else
+		       1
+#endif
+		       );
+	}
+
+	return bad != 0;
+}
+#endif /* ALGO_NO_MAIN */
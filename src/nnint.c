@@ -1,106 +1,797 @@
-/*******************************************************************************
-	nnint.c -- 床・天井
-	※奥村教授の事典っぽく。第三版を出すというお話をいただいて
-*******************************************************************************/
-#include <math.h> /* frexp(), ldexp(), isfinite() */
-
-/* 床関数の元 */
-static inline double
-floor_bisect(double x)
-{
-	int base_exp;
-	double frac, eq, s, t;
-	
-	if (x < 2)
-		return (double)(int)x;
-	
-	// use frexp
-	frac = frexp(x, &base_exp);
-	base_exp--; 
-	frac = (frac-0.5)*2;
-	
-	s = 0.0; t = 1.0 / 2;
-
-	for (volatile int i = 0; i < base_exp; i++)
-	{
-		if (frac >= (s + t))  s += t;
-		if (s == frac)  break;
-		t /= 2;
-	}
-
-	eq = ldexp(1.0, base_exp);
-
-	return eq + eq * s;
-
-}
-
-/* 天井関数の元  */
-static inline double
-ceil_bisect(double x)
-{
-	int base_exp;
-	double frac, eq, s, t;
-	
-	if (x < 2)
-		return (int)x == x ? x : (double)(int)(x + 1);
-	
-	// use frexp
-	frac = frexp(x, &base_exp);
-	base_exp--; 
-	frac = (frac-0.5)*2;
-	
-	s = 0.0; t = 1.0 / 2;
-
-	for (volatile int i = 0; i < base_exp; i++)
-	{
-		if (frac >= (s + t))  s += t;
-		if (s == frac)  break;
-		t /= 2;
-	}
-
-	eq = ldexp(1.0, base_exp);
-
-	return s == frac ? eq + eq * s : eq + eq * (s + 1.0 / eq);
-}
-
-/* 床関数 $\left\lfloor{x}\right\rfloor$ */
-double
-my_floor(double x)
-{
-	if (isfinite(x)) // 有限のみ入場
-		return x < 0 ? -ceil_bisect(-x) : floor_bisect(x);
-	return x; // 他は退場
-}
-
-/* 天井関数 $\left\lceil{x}\right\rceil$ */
-double
-my_ceil(double x)
-{
-	if (isfinite(x)) // 有限のみ入場
-		return x < 0 ? -floor_bisect(-x) : ceil_bisect(x);
-	return x; // 他は退場
-}
-
-/* trunc */
-double
-my_trunc(double)
-{
-	if (isfinite(x)) // 有限のみ入場
-		return x < 0 ? -floor_bisect(-x) : floor_bisect(x);
-	return x; // 他は退場
-}
-
-
-#include <stdio.h>
-#include <stdlib.h>
-int
-main(void)
-{
-	double x;
-	puts("test of floor, ceil");
-	printf("x = ? "); scanf("%lf", &x);
-	printf("floor(%f) = %g\n", x, my_floor(x));
-	printf("ceil(%f) = %g\n", x, my_ceil(x));
-	
-	return 0;
-}
+/*******************************************************************************
+	nnint.c -- 床・天井
+	※奥村教授の事典っぽく。第三版を出すというお話をいただいて
+*******************************************************************************/
+#include <math.h> /* frexp(), ldexp(), isfinite(), fabs(), copysign() */
+#include <stdint.h>
+#include <stdio.h>  /* snprintf() */
+#include <stdlib.h> /* strtod(), atoi() */
+#include <string.h> /* memcpy(), strchr() */
+#include "algomath.h"
+
+/* 床関数の元 */
+static inline double
+floor_bisect(double x)
+{
+	int base_exp;
+	double frac, eq, s, t;
+	
+	if (x < 2)
+		return (double)(int)x;
+	
+	// use frexp
+	frac = frexp(x, &base_exp);
+	base_exp--; 
+	frac = (frac-0.5)*2;
+	
+	s = 0.0; t = 1.0 / 2;
+
+	for (volatile int i = 0; i < base_exp; i++)
+	{
+		if (frac >= (s + t))  s += t;
+		if (s == frac)  break;
+		t /= 2;
+	}
+
+	eq = ldexp(1.0, base_exp);
+
+	return eq + eq * s;
+
+}
+
+/* 天井関数の元  */
+static inline double
+ceil_bisect(double x)
+{
+	int base_exp;
+	double frac, eq, s, t;
+	
+	if (x < 2)
+		return (int)x == x ? x : (double)(int)(x + 1);
+	
+	// use frexp
+	frac = frexp(x, &base_exp);
+	base_exp--; 
+	frac = (frac-0.5)*2;
+	
+	s = 0.0; t = 1.0 / 2;
+
+	for (volatile int i = 0; i < base_exp; i++)
+	{
+		if (frac >= (s + t))  s += t;
+		if (s == frac)  break;
+		t /= 2;
+	}
+
+	eq = ldexp(1.0, base_exp);
+
+	return s == frac ? eq + eq * s : eq + eq * (s + 1.0 / eq);
+}
+
+/* 二分検索による床関数 (差分テストの参照用) */
+double
+my_floor_bisect(double x)
+{
+	if (isfinite(x) && x != 0) // 有限のみ入場 ($\pm 0$はそのまま返して符号を残す)
+		return x < 0 ? -ceil_bisect(-x) : floor_bisect(x);
+	return x; // 他は退場
+}
+
+/* 二分検索による天井関数 (差分テストの参照用) */
+double
+my_ceil_bisect(double x)
+{
+	if (isfinite(x) && x != 0) // 有限のみ入場 ($\pm 0$はそのまま返して符号を残す)
+		return x < 0 ? -floor_bisect(-x) : ceil_bisect(x);
+	return x; // 他は退場
+}
+
+/* 二分検索によるtrunc (差分テストの参照用) */
+double
+my_trunc_bisect(double x)
+{
+	if (isfinite(x) && x != 0) // 有限のみ入場 ($\pm 0$はそのまま返して符号を残す)
+		return x < 0 ? -floor_bisect(-x) : floor_bisect(x);
+	return x; // 他は退場
+}
+
+/* 0の方向への切り捨てをビット演算で
+ * 指数eから小数部のビットを求めてマスクで落とす。ループも分岐もない。
+ * $e < 0$ ($|x| < 1$)なら符号だけ残して$\pm 0$，$e \geq 52$ (整数・無限大・NaN)なら
+ * そのまま。
+ */
+static inline double
+trunc_bits(double x)
+{
+	uint64_t u, m;
+	int e;
+
+	memcpy(&u, &x, sizeof u);
+	e = (int)((u >> 52) & 0x7FF) - 1023;
+	m = e < 0 ? UINT64_C(0x7FFFFFFFFFFFFFFF)
+	  : e >= 52 ? 0 : UINT64_C(0x000FFFFFFFFFFFFF) >> e;
+	u &= ~m;
+	memcpy(&x, &u, sizeof x);
+	return x;
+}
+
+/* 床関数 $\left\lfloor{x}\right\rfloor$ */
+double
+my_floor(double x)
+{
+	double t = trunc_bits(x);
+
+	return t - (x < t); // 負で小数部があれば1つ下
+}
+
+/* 天井関数 $\left\lceil{x}\right\rceil$ */
+double
+my_ceil(double x)
+{
+	double t = trunc_bits(x);
+
+	return copysign(t + (x > t), x); // 正で小数部があれば1つ上。$(-1, 0)$は$-0$
+}
+
+/* trunc */
+double
+my_trunc(double x)
+{
+	return trunc_bits(x);
+}
+
+/* 四捨五入 (0.5は0から遠い方へ)
+ * $d = x - t$は正確に求まるので，$|d| \geq 0.5$なら$t$を0から1つ遠ざける。
+ * 無限大では$d$がNaNとなり比較が偽になるので，$t$のまま返る。
+ */
+double
+my_round(double x)
+{
+	double t = trunc_bits(x);
+
+	return t + copysign((double)(fabs(x - t) >= 0.5), x);
+}
+
+/* 偶数丸め (0.5はちょうど偶数の方へ)。丸めモードに依存しない */
+double
+my_roundeven(double x)
+{
+	double t = trunc_bits(x), a = fabs(x - t), h = t * 0.5;
+
+	return t + copysign((double)((a > 0.5) | ((a == 0.5) & (trunc_bits(h) != h))), x);
+}
+
+/* nearbyint -- 現在の丸めモードで整数へ
+ * $|x| < 2^{52}$なら$2^{52}$を足して引くと，足した時点で小数部が丸めモードに従って
+ * 落ちる。それ以外は$m = 0$で素通し。$-0.3$などの符号はcopysign()で戻す。
+ */
+double
+my_nearbyint(double x)
+{
+	const double two52 = 4503599627370496.0;
+	double m = fabs(x) < two52 ? copysign(two52, x) : 0;
+
+	return copysign((x + m) - m, x);
+}
+
+/* 単精度のtrunc_bits()。指数のバイアスは127，仮数は23ビット */
+static inline float
+trunc_bitsf(float x)
+{
+	uint32_t u, m;
+	int e;
+
+	memcpy(&u, &x, sizeof u);
+	e = (int)((u >> 23) & 0xFF) - 127;
+	m = e < 0 ? UINT32_C(0x7FFFFFFF) : e >= 23 ? 0 : UINT32_C(0x007FFFFF) >> e;
+	u &= ~m;
+	memcpy(&x, &u, sizeof x);
+	return x;
+}
+
+static inline float floor_bitsf(float x) { float t = trunc_bitsf(x); return t - (x < t); }
+static inline float ceil_bitsf(float x)  { float t = trunc_bitsf(x); return copysignf(t + (x > t), x); }
+
+static inline float
+round_bitsf(float x)
+{
+	float t = trunc_bitsf(x);
+
+	return t + copysignf((float)(fabsf(x - t) >= 0.5f), x);
+}
+
+static inline float
+roundeven_bitsf(float x)
+{
+	float t = trunc_bitsf(x), a = fabsf(x - t), h = t * 0.5f;
+
+	return t + copysignf((float)((a > 0.5f) | ((a == 0.5f) & (trunc_bitsf(h) != h))), x);
+}
+
+static inline float
+nearbyint_bitsf(float x)
+{
+	const float two23 = 8388608.0f;
+	float m = fabsf(x) < two23 ? copysignf(two23, x) : 0;
+
+	return copysignf((x + m) - m, x);
+}
+
+/* ベクトル化
+ * AVX-512ではvrndscale，AVX(2)とSSE4.1ではroundpd/roundpsの即値で丸め方向を選ぶ。
+ * どれも即値の下位2ビットが方向，ビット2が「MXCSRに従う」なので，_MM_FROUND_*を
+ * 共用できる。四捨五入だけは命令にないので，$t = \mathrm{trunc}(x)$に
+ * $\mathrm{trunc}(2(x - t))$を足す。$x - t$はNaN (無限大・NaN)のレーンだけ$x$を残す。
+ * 和が0になると$-0.3$なども$+0$になるので，最後に$x$の符号ビットを論理和で戻す
+ * (0でなければ符号は元から$x$と同じ)。
+ * どれも無ければ上のビット演算のスカラー版を回す。
+ */
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define NN_DLEN 8
+#define NN_FLEN 16
+typedef __m512d nn_dvec_t;
+typedef __m512  nn_fvec_t;
+#define nn_dload(p)           _mm512_loadu_pd(p)
+#define nn_dstore(p, v)       _mm512_storeu_pd(p, v)
+#define nn_dround(v, m)       _mm512_roundscale_pd(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_dsub(a, b)         _mm512_sub_pd(a, b)
+#define nn_dadd(a, b)         _mm512_add_pd(a, b)
+#define nn_dadd_ord(d, x, a, b) _mm512_mask_add_pd(x, _mm512_cmp_pd_mask(d, d, _CMP_ORD_Q), a, b)
+#define nn_dorsign(r, x)      _mm512_castsi512_pd(_mm512_ternarylogic_epi64(_mm512_castpd_si512(r), \
+                                  _mm512_castpd_si512(x), _mm512_set1_epi64(INT64_MIN), 0xF8))
+#define nn_fload(p)           _mm512_loadu_ps(p)
+#define nn_fstore(p, v)       _mm512_storeu_ps(p, v)
+#define nn_fround(v, m)       _mm512_roundscale_ps(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_fsub(a, b)         _mm512_sub_ps(a, b)
+#define nn_fadd(a, b)         _mm512_add_ps(a, b)
+#define nn_fadd_ord(d, x, a, b) _mm512_mask_add_ps(x, _mm512_cmp_ps_mask(d, d, _CMP_ORD_Q), a, b)
+#define nn_forsign(r, x)      _mm512_castsi512_ps(_mm512_ternarylogic_epi32(_mm512_castps_si512(r), \
+                                  _mm512_castps_si512(x), _mm512_set1_epi32(INT32_MIN), 0xF8))
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define NN_DLEN 4
+#define NN_FLEN 8
+typedef __m256d nn_dvec_t;
+typedef __m256  nn_fvec_t;
+#define nn_dload(p)           _mm256_loadu_pd(p)
+#define nn_dstore(p, v)       _mm256_storeu_pd(p, v)
+#define nn_dround(v, m)       _mm256_round_pd(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_dsub(a, b)         _mm256_sub_pd(a, b)
+#define nn_dadd(a, b)         _mm256_add_pd(a, b)
+#define nn_dadd_ord(d, x, a, b) _mm256_blendv_pd(x, _mm256_add_pd(a, b), _mm256_cmp_pd(d, d, _CMP_ORD_Q))
+#define nn_dorsign(r, x)      _mm256_or_pd(r, _mm256_and_pd(x, _mm256_set1_pd(-0.0)))
+#define nn_fload(p)           _mm256_loadu_ps(p)
+#define nn_fstore(p, v)       _mm256_storeu_ps(p, v)
+#define nn_fround(v, m)       _mm256_round_ps(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_fsub(a, b)         _mm256_sub_ps(a, b)
+#define nn_fadd(a, b)         _mm256_add_ps(a, b)
+#define nn_fadd_ord(d, x, a, b) _mm256_blendv_ps(x, _mm256_add_ps(a, b), _mm256_cmp_ps(d, d, _CMP_ORD_Q))
+#define nn_forsign(r, x)      _mm256_or_ps(r, _mm256_and_ps(x, _mm256_set1_ps(-0.0f)))
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define NN_DLEN 2
+#define NN_FLEN 4
+typedef __m128d nn_dvec_t;
+typedef __m128  nn_fvec_t;
+#define nn_dload(p)           _mm_loadu_pd(p)
+#define nn_dstore(p, v)       _mm_storeu_pd(p, v)
+#define nn_dround(v, m)       _mm_round_pd(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_dsub(a, b)         _mm_sub_pd(a, b)
+#define nn_dadd(a, b)         _mm_add_pd(a, b)
+#define nn_dadd_ord(d, x, a, b) _mm_blendv_pd(x, _mm_add_pd(a, b), _mm_cmpord_pd(d, d))
+#define nn_dorsign(r, x)      _mm_or_pd(r, _mm_and_pd(x, _mm_set1_pd(-0.0)))
+#define nn_fload(p)           _mm_loadu_ps(p)
+#define nn_fstore(p, v)       _mm_storeu_ps(p, v)
+#define nn_fround(v, m)       _mm_round_ps(v, (m) | _MM_FROUND_NO_EXC)
+#define nn_fsub(a, b)         _mm_sub_ps(a, b)
+#define nn_fadd(a, b)         _mm_add_ps(a, b)
+#define nn_fadd_ord(d, x, a, b) _mm_blendv_ps(x, _mm_add_ps(a, b), _mm_cmpord_ps(d, d))
+#define nn_forsign(r, x)      _mm_or_ps(r, _mm_and_ps(x, _mm_set1_ps(-0.0f)))
+#endif
+
+#ifdef NN_DLEN
+static inline nn_dvec_t
+nn_dround_away(nn_dvec_t x)
+{
+	nn_dvec_t t = nn_dround(x, _MM_FROUND_TO_ZERO), d = nn_dsub(x, t);
+
+	return nn_dorsign(nn_dadd_ord(d, x, t, nn_dround(nn_dadd(d, d), _MM_FROUND_TO_ZERO)), x);
+}
+
+static inline nn_fvec_t
+nn_fround_away(nn_fvec_t x)
+{
+	nn_fvec_t t = nn_fround(x, _MM_FROUND_TO_ZERO), d = nn_fsub(x, t);
+
+	return nn_forsign(nn_fadd_ord(d, x, t, nn_fround(nn_fadd(d, d), _MM_FROUND_TO_ZERO)), x);
+}
+
+/* 即値は定数でなければならないので，モードごとにループを展開する */
+#define NN_VLOOP(LEN, LOAD, STORE, OP) \
+	for (; i + LEN <= len; i += LEN)  STORE(y + i, OP(LOAD(x + i)))
+#define NN_VSWITCH(LEN, LOAD, STORE, AWAY) \
+	switch (mode) { \
+	case NNINT_FLOOR:     NN_VLOOP(LEN, LOAD, STORE, NN_ROUND_NEG); break; \
+	case NNINT_CEIL:      NN_VLOOP(LEN, LOAD, STORE, NN_ROUND_POS); break; \
+	case NNINT_TRUNC:     NN_VLOOP(LEN, LOAD, STORE, NN_ROUND_ZERO); break; \
+	case NNINT_ROUND:     NN_VLOOP(LEN, LOAD, STORE, AWAY); break; \
+	case NNINT_ROUNDEVEN: NN_VLOOP(LEN, LOAD, STORE, NN_ROUND_EVEN); break; \
+	case NNINT_NEARBYINT: NN_VLOOP(LEN, LOAD, STORE, NN_ROUND_CUR); break; \
+	}
+#endif /* NN_DLEN */
+
+/* スカラーの残り (とベクトル化できないとき全部) */
+#define NN_SLOOP(OP)  for (; i < len; i++)  y[i] = OP(x[i])
+#define NN_SSWITCH(FLOOR, CEIL, TRUNC, ROUND, EVEN, NEAR) \
+	switch (mode) { \
+	case NNINT_FLOOR:     NN_SLOOP(FLOOR); break; \
+	case NNINT_CEIL:      NN_SLOOP(CEIL); break; \
+	case NNINT_TRUNC:     NN_SLOOP(TRUNC); break; \
+	case NNINT_ROUND:     NN_SLOOP(ROUND); break; \
+	case NNINT_ROUNDEVEN: NN_SLOOP(EVEN); break; \
+	case NNINT_NEARBYINT: NN_SLOOP(NEAR); break; \
+	default: return -1; \
+	}
+
+/* 倍精度の配列をmodeで丸める。y = xでもよい。modeが不正なら-1 */
+int
+nnint_round_array(int mode, int len, const double *x, double *y)
+{
+	int i = 0;
+
+#ifdef NN_DLEN
+#define NN_ROUND_NEG(v)  nn_dround(v, _MM_FROUND_TO_NEG_INF)
+#define NN_ROUND_POS(v)  nn_dround(v, _MM_FROUND_TO_POS_INF)
+#define NN_ROUND_ZERO(v) nn_dround(v, _MM_FROUND_TO_ZERO)
+#define NN_ROUND_EVEN(v) nn_dround(v, _MM_FROUND_TO_NEAREST_INT)
+#define NN_ROUND_CUR(v)  nn_dround(v, _MM_FROUND_CUR_DIRECTION)
+	NN_VSWITCH(NN_DLEN, nn_dload, nn_dstore, nn_dround_away)
+#undef NN_ROUND_NEG
+#undef NN_ROUND_POS
+#undef NN_ROUND_ZERO
+#undef NN_ROUND_EVEN
+#undef NN_ROUND_CUR
+#endif
+	NN_SSWITCH(my_floor, my_ceil, my_trunc, my_round, my_roundeven, my_nearbyint)
+	return 0;
+}
+
+/* 単精度の配列をmodeで丸める */
+int
+nnint_round_arrayf(int mode, int len, const float *x, float *y)
+{
+	int i = 0;
+
+#ifdef NN_FLEN
+#define NN_ROUND_NEG(v)  nn_fround(v, _MM_FROUND_TO_NEG_INF)
+#define NN_ROUND_POS(v)  nn_fround(v, _MM_FROUND_TO_POS_INF)
+#define NN_ROUND_ZERO(v) nn_fround(v, _MM_FROUND_TO_ZERO)
+#define NN_ROUND_EVEN(v) nn_fround(v, _MM_FROUND_TO_NEAREST_INT)
+#define NN_ROUND_CUR(v)  nn_fround(v, _MM_FROUND_CUR_DIRECTION)
+	NN_VSWITCH(NN_FLEN, nn_fload, nn_fstore, nn_fround_away)
+#undef NN_ROUND_NEG
+#undef NN_ROUND_POS
+#undef NN_ROUND_ZERO
+#undef NN_ROUND_EVEN
+#undef NN_ROUND_CUR
+#endif
+	NN_SSWITCH(floor_bitsf, ceil_bitsf, trunc_bitsf, round_bitsf, roundeven_bitsf, nearbyint_bitsf)
+	return 0;
+}
+
+/* 整数への飽和変換。範囲外は端に張り付け，NaNは0とする */
+static inline int32_t
+nn_sat_i32(double r)
+{
+	return r != r ? 0 : r <= -2147483648.0 ? INT32_MIN
+	     : r >= 2147483647.0 ? INT32_MAX : (int32_t)r;
+}
+
+static inline int64_t
+nn_sat_i64(double r)
+{
+	return r != r ? 0 : r <= -9223372036854775808.0 ? INT64_MIN
+	     : r >= 9223372036854775808.0 ? INT64_MAX : (int64_t)r;
+}
+
+/* 丸めと整数化の融合
+ * NN_CHUNK個ずつスタック上で丸めてから変換するので，入力は一度しか読まない。
+ * 丸めた値は整数なので，変換は切り捨てのキャストでよい。
+ */
+#define NN_CHUNK 256
+#define NN_CONVERT(T, ROUND, SAT) \
+	T buf[NN_CHUNK]; \
+	int i, j, m; \
+	for (i = 0; i < len; i += m) { \
+		m = len - i < NN_CHUNK ? len - i : NN_CHUNK; \
+		if (ROUND(mode, m, x + i, buf))  return -1; \
+		for (j = 0; j < m; j++)  y[i + j] = SAT(buf[j]); \
+	} \
+	return 0
+
+int
+nnint_round_i32(int mode, int len, const double *x, int32_t *y)
+{
+	NN_CONVERT(double, nnint_round_array, nn_sat_i32);
+}
+
+int
+nnint_round_i64(int mode, int len, const double *x, int64_t *y)
+{
+	NN_CONVERT(double, nnint_round_array, nn_sat_i64);
+}
+
+int
+nnint_round_i32f(int mode, int len, const float *x, int32_t *y)
+{
+	NN_CONVERT(float, nnint_round_arrayf, nn_sat_i32);
+}
+
+int
+nnint_round_i64f(int mode, int len, const float *x, int64_t *y)
+{
+	NN_CONVERT(float, nnint_round_arrayf, nn_sat_i64);
+}
+
+
+/* 10進の桁での床・天井・四捨五入
+ * 倍精度の1.005は実際には1.00499999999999989...なので，$x \times 10^d$を丸めて
+ * $10^d$で割る素朴な方法は，人が書いた1.005を1.00に，0.29の床を0.28にしてしまう。
+ * ここでは$x$を「往復して$x$に戻る最短の10進表記」とみなして丸める(printf("%.17g")
+ * ではなく，人が入力した値として扱う)。
+ */
+static const double dec_pow10[22] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21
+};
+
+/* $ab = p + e$を正確に分ける。FMAが無ければDekkerの分割 */
+static inline double
+dec_two_prod(double a, double b, double *e)
+{
+	double p = a * b;
+#ifdef __FMA__
+	*e = fma(a, b, -p);
+#else
+	const double split = 134217729.0; /* $2^{27} + 1$ */
+	double t, ah, al, bh, bl;
+
+	t = split * a;  ah = t - (t - a);  al = a - ah;
+	t = split * b;  bh = t - (t - b);  bl = b - bh;
+	*e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+	return p;
+}
+
+/* 遅い道: 最短の10進表記をsnprintf()で作り，文字列のまま丸めてstrtod()で戻す。
+ * $x > 0$で，modeは床・天井・四捨五入のいずれか。速い道の範囲外と差分テストに使う。
+ */
+static double
+dec_round_string(double x, int digits, int mode)
+{
+	char buf[40], out[48];
+	int prec, n, k, i, exp10, up;
+	char *s;
+
+	for (prec = 1; prec <= 17; prec++)  /* 17桁なら必ず戻る */
+	{
+		snprintf(buf, sizeof buf, "%.*e", prec - 1, x);
+		if (strtod(buf, NULL) == x)  break;
+	}
+	s = strchr(buf, 'e');
+	exp10 = atoi(s + 1);
+	for (n = 0, s = buf; *s != 'e'; s++)  /* 仮数の数字だけを詰める */
+		if (*s != '.')  buf[n++] = *s;
+	k = exp10 + 1 + digits;  /* 残す桁数 */
+	if (k >= n)
+		return x;
+	switch (mode) {
+	case NNINT_FLOOR: up = 0; break;
+	case NNINT_CEIL:  up = 1; break;  /* 落とす桁は必ず0でない数字を含む */
+	default:          up = k >= 0 && buf[k] >= '5'; break;
+	}
+	if (k < 0)  k = 0;
+	out[0] = '0';  /* 繰り上がり用 */
+	memcpy(out + 1, buf, k);
+	for (i = k; up && i >= 0; i--)
+		if (out[i] == '9')  out[i] = '0';
+		else  { out[i]++;  up = 0; }
+	snprintf(out + 1 + k, sizeof out - 1 - k, "e%d", -digits);
+	return strtod(out, NULL);
+}
+
+/* 10進の丸めの本体
+ * $0 \leq d \leq 21$かつ$|x| \times 10^d < 2^{53}$なら，$p + e = |x| \times 10^d$を
+ * 正確に求めて整数部$f$を取る。$f$か$f+1$のうち近い方を$10^d$で割って$x$に戻れば，
+ * $x$はもともと$d$桁の10進数なのでそのまま返す。戻らなければ最短表記と2進の値の間に
+ * $d$桁の10進数は無いので，床は$f$，天井は$f+1$でよい。四捨五入ではちょうど半分の
+ * $(10f+5) \times 10^{-(d+1)}$が$x$に戻るかも見る。$|x| \times 10^{d+1}$が$2^{52}$を
+ * 越えると隣の$10f+4$や$10f+6$も戻りうり，最短表記はそのうち$x$に近い方なので，
+ * そのときと$2^{49}$以上で半分に近いときは文字列で。負は床と天井を入れ替えて絶対値で扱う。
+ */
+static double
+dec_round(double x, int digits, int mode)
+{
+	double ax = fabs(x), P, p, e, f, hi, r;
+
+	if (x < 0 && mode != NNINT_ROUND)
+		mode = mode == NNINT_FLOOR ? NNINT_CEIL : NNINT_FLOOR;
+	if (!(ax > 0) || !isfinite(ax))
+		return x;
+	if (digits < 0 || digits > 21)
+		return copysign(dec_round_string(ax, digits, mode), x);
+
+	P = dec_pow10[digits];
+	p = dec_two_prod(ax, P, &e);
+	if (p >= 18014398509481984.0)  /* $2^{54}$以上なら$x$の往復区間は$10^{-d}$より広い */
+		return x;
+	if (p >= 9007199254740992.0)   /* $2^{53}$以上は$f+1$が正確でない */
+		return copysign(dec_round_string(ax, digits, mode), x);
+	f = my_floor(p);
+	if (p == f && e < 0)  f -= 1;  /* 正確な積の床 */
+	hi = p - f;
+	r = (hi > 0.5 || (hi == 0.5 && e >= 0)) ? f + 1 : f;
+	if (r / P == ax)
+		return x;
+	switch (mode) {
+	case NNINT_FLOOR: r = f; break;
+	case NNINT_CEIL:  r = f + 1; break;
+	default:
+		if (p < 562949953421312.0)  /* $2^{49}$未満なら$10f+5$は正確 */
+		{
+			if ((10 * f + 5) / (10 * P) == ax)  /* 人の目にはちょうど半分…… */
+			{
+				/* ……ただし$d+1$桁の隣も戻るなら，最短表記は$x$に近い方なので文字列で */
+				if ((10 * f + 4) / (10 * P) == ax || (10 * f + 6) / (10 * P) == ax)
+					return copysign(dec_round_string(ax, digits, mode), x);
+				r = f + 1;
+			}
+		}
+		else if (fabs(hi - 0.5) <= p * 0x1p-50)  /* 半分が往復しうるときだけ文字列で */
+			return copysign(dec_round_string(ax, digits, mode), x);
+		break;
+	}
+	return copysign(r / P, x);
+}
+
+/* 小数点以下digits桁への床 (digitsが負なら10の位などへ) */
+double
+floor10(double x, int digits)
+{
+	return dec_round(x, digits, NNINT_FLOOR);
+}
+
+/* 小数点以下digits桁への天井 */
+double
+ceil10(double x, int digits)
+{
+	return dec_round(x, digits, NNINT_CEIL);
+}
+
+/* 小数点以下digits桁への四捨五入 (0.5は0から遠い方へ) */
+double
+round10(double x, int digits)
+{
+	return dec_round(x, digits, NNINT_ROUND);
+}
+
+void
+floor10_batch(int len, const double *x, int digits, double *y)
+{
+	for (int i = 0; i < len; i++)  y[i] = dec_round(x[i], digits, NNINT_FLOOR);
+}
+
+void
+ceil10_batch(int len, const double *x, int digits, double *y)
+{
+	for (int i = 0; i < len; i++)  y[i] = dec_round(x[i], digits, NNINT_CEIL);
+}
+
+void
+round10_batch(int len, const double *x, int digits, double *y)
+{
+	for (int i = 0; i < len; i++)  y[i] = dec_round(x[i], digits, NNINT_ROUND);
+}
+
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 二分検索版との差分テスト。ビットごとに比べるので$-0$と$+0$も区別する。
+ * 食い違いの数を返す */
+static int
+nnint_differential(void)
+{
+	enum { LEN = 1 << 20 };
+	static double xs[LEN];
+	static const char *name[3] = { "floor", "ceil", "trunc" };
+	double (*bits[3])(double) = { my_floor, my_ceil, my_trunc };
+	double (*ref[3])(double) = { my_floor_bisect, my_ceil_bisect, my_trunc_bisect };
+	double y, r;
+	volatile double sink = 0;
+	clock_t c0, c1, c2;
+	uint64_t u;
+	int i, j, bad, total = 0;
+
+	srand(1);
+	for (i = 0; i < LEN; i++)  /* 全域: ランダムなビット列(NaNを除く) */
+	{
+		do {
+			u = (uint64_t)rand() << 62 ^ (uint64_t)rand() << 31 ^ (uint64_t)rand();
+			if (i % 2)  /* 半分は$|x| < 2^{60}$に寄せる */
+				u = (u & UINT64_C(0x800FFFFFFFFFFFFF)) | (uint64_t)(1023 - 4 + rand() % 64) << 52;
+			memcpy(&xs[i], &u, sizeof u);
+		} while (xs[i] != xs[i]);
+	}
+	xs[0] = -0.0;  xs[1] = -0.5;  xs[2] = 0.0;
+	for (j = 0; j < 3; j++)
+	{
+		for (i = bad = 0; i < LEN; i++)
+		{
+			y = bits[j](xs[i]);  r = ref[j](xs[i]);
+			if (memcmp(&y, &r, sizeof y))
+				bad++;
+		}
+		c0 = clock();
+		for (i = 0; i < LEN; i++)  sink += ref[j](xs[i]);
+		c1 = clock();
+		for (i = 0; i < LEN; i++)  sink += bits[j](xs[i]);
+		c2 = clock();
+		printf("%-5s: %d mismatches / %d, bisect %.2f ns, bits %.2f ns\n", name[j], bad, LEN,
+		       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN);
+		total += bad;
+	}
+	return total;
+}
+
+/* 配列版をlibmと突き合わせ，1要素ずつlibmを呼ぶのと速さを比べる */
+static void
+nnint_array_demo(void)
+{
+	enum { LEN = 1 << 16, REP = 64 };
+	static double xs[LEN], ys[LEN];
+	static float xf[LEN], yf[LEN];
+	static int64_t yi[LEN];
+	static const char *name[6] = { "floor", "ceil", "trunc", "round", "roundeven", "nearbyint" };
+	double (*ref[6])(double) = { floor, ceil, trunc, round, rint, nearbyint };
+	float (*reff[6])(float) = { floorf, ceilf, truncf, roundf, rintf, nearbyintf };
+	volatile double sink = 0;
+	clock_t c0, c1, c2;
+	int i, j, r, bad, badf, badi;
+
+	srand(2);
+	for (i = 0; i < LEN; i++)
+	{
+		xs[i] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 4);
+		if (i % 8 == 0)  xs[i] = (rand() % 200 - 100) * 0.5;  /* ちょうど半分 */
+		xf[i] = (float)xs[i];
+	}
+	xs[1] = INFINITY; xs[2] = -INFINITY; xs[3] = NAN; xs[5] = -0.25; xs[7] = 1e300;
+	xs[9] = -0.0; xs[10] = -0.49999999999999994; xs[11] = -0.5; xs[12] = -1e-300;
+	xf[1] = INFINITY; xf[2] = -INFINITY; xf[3] = NAN; xf[5] = -0.25f;
+	xf[9] = -0.0f; xf[10] = -0.49999997f; xf[11] = -0.5f; xf[12] = -1e-30f;
+	for (j = 0; j < 6; j++)
+	{
+		nnint_round_array(j, LEN, xs, ys);
+		nnint_round_arrayf(j, LEN, xf, yf);
+		nnint_round_i64(j, LEN, xs, yi);
+		for (i = bad = badf = badi = 0; i < LEN; i++)
+		{
+			double e = ref[j](xs[i]);
+			float ef = reff[j](xf[i]);
+			if (memcmp(&ys[i], &e, sizeof e) && !(e != e && ys[i] != ys[i]))  bad++;
+			if (memcmp(&yf[i], &ef, sizeof ef) && !(ef != ef && yf[i] != yf[i]))  badf++;
+			if (e == e && fabs(e) < 9e18 && yi[i] != (int64_t)e)  badi++;
+		}
+		c0 = clock();
+		for (r = 0; r < REP; r++)
+			for (i = 0; i < LEN; i++)  ys[i] = ref[j](xs[i]);
+		c1 = clock();
+		for (r = 0; r < REP; r++)
+			nnint_round_array(j, LEN, xs, ys);
+		c2 = clock();
+		sink += ys[LEN - 1];
+		printf("%-9s: %d/%d/%d mismatches (double/float/int64), libm %.2f ns, array %.2f ns\n",
+		       name[j], bad, badf, badi,
+		       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN / REP);
+	}
+}
+
+/* 10進の丸め: 文字列経由との差分テストと速さの比較。食い違いの数を返す */
+static int
+dec_round_demo(void)
+{
+	enum { LEN = 1 << 16 };
+	static double xs[LEN], y1[LEN];
+	static const char *name[3] = { "floor10", "ceil10", "round10" };
+	static const int mode[3] = { NNINT_FLOOR, NNINT_CEIL, NNINT_ROUND };
+	char buf[40];
+	volatile double sink = 0;
+	clock_t c0, c1, c2, c3;
+	int i, j, d, bad, naive, total = 0;
+
+	printf("round10(1.005, 2) = %.17g, floor10(0.29, 2) = %.17g, ceil10(-2.675, 2) = %.17g\n",
+	       round10(1.005, 2), floor10(0.29, 2), ceil10(-2.675, 2));
+
+	/* $|x| \times 10^{d+1}$が$2^{52}$を少し越えるところ: 半分の$10f+5$も隣の$d+1$桁も
+	 * 戻る。546350936.13098145の最短表記は…1309814なので…130981 */
+	srand(5);
+	for (i = bad = 0; i < LEN; i++)
+	{
+		double x;
+
+		d = i % 7;
+		x = i == 0 ? 546350936.13098145 : 0x1p52 / dec_pow10[d + 1] * (1 + 0.25 * rand() / RAND_MAX);
+		if (i == 0)  d = 6;
+		if (i % 2)  x = -x;
+		bad += round10(x, d) != copysign(dec_round_string(fabs(x), d, NNINT_ROUND), x);
+	}
+	printf("round10(546350936.13098145, 6) = %.17g, near 2^52: %d mismatches\n",
+	       round10(546350936.13098145, 6), bad);
+	total += bad;
+	srand(3);
+	for (i = 0; i < LEN; i++)  /* 半分は人が書いた10進数，残りは任意の倍精度数 */
+	{
+		if (i % 2 == 0)
+		{
+			snprintf(buf, sizeof buf, "%s%d.%0*d", rand() % 2 ? "-" : "",
+			         rand() % 100000, 1 + rand() % 6, rand() % 1000000);
+			xs[i] = strtod(buf, NULL);
+		}
+		else
+			xs[i] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 60 - 20);
+	}
+	for (j = 0; j < 3; j++)
+		for (d = 0; d <= 6; d += 2)
+		{
+			double P = dec_pow10[d];
+
+			for (i = bad = naive = 0; i < LEN; i++)
+			{
+				double ax = fabs(xs[i]), ref, nv;
+				int m = mode[j];
+
+				if (xs[i] < 0 && m != NNINT_ROUND)
+					m = m == NNINT_FLOOR ? NNINT_CEIL : NNINT_FLOOR;
+				ref = copysign(dec_round_string(ax, d, m), xs[i]);
+				nv = (j == 0 ? floor(xs[i] * P) : j == 1 ? ceil(xs[i] * P) : round(xs[i] * P)) / P;
+				bad += dec_round(xs[i], d, mode[j]) != ref;
+				naive += nv != ref;
+			}
+			total += bad;
+			c0 = clock();
+			for (i = 0; i < LEN; i++)  sink += dec_round(xs[i], d, mode[j]);
+			c1 = clock();
+			for (i = 0; i < LEN; i++)  sink += dec_round_string(fabs(xs[i]), d, mode[j]);
+			c2 = clock();
+			for (i = 0; i < LEN; i++)  sink += round(xs[i] * P) / P;
+			c3 = clock();
+			printf("%s(x, %d): %d mismatches (naive pow: %d), fast %.1f ns, snprintf %.1f ns, naive %.1f ns\n",
+			       name[j], d, bad, naive,
+			       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN,
+			       1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN);
+		}
+	round10_batch(LEN, xs, 2, y1);
+	sink += y1[0];
+	return total;
+}
+
+int
+main(void)
+{
+	double x;
+	int bad;
+	puts("test of floor, ceil");
+	printf("x = ? "); scanf("%lf", &x);
+	printf("floor(%f) = %g\n", x, my_floor(x));
+	printf("ceil(%f) = %g\n", x, my_ceil(x));
+	printf("trunc(%f) = %g\n", x, my_trunc(x));
+
+	bad = nnint_differential();
+	nnint_array_demo();
+	bad += dec_round_demo();
+	return bad != 0;
+}
+#endif /* ALGO_NO_MAIN */
@@ -0,0 +1,506 @@
+/*******************************************************************************
+	pcmconv.c -- パルス符号変調の形式の変換
+	    pcmconv [-f 形式] -t 形式 [-w] [-c チャンネル数] [-r 標本化周波数]
+	            [-o 出力] [-v] [入力]
+	形式は u8 s16 s24 s32 (lpcm_codec), ulaw (pcmu_codec), alaw (pcma_codec)。
+	入力がRIFF/WAVEなら見出しから形式を読み，そうでなければ-fの形式の生の列とする。
+	入力・出力を省くか-なら標準入力・標準出力。-wでWAVEの見出しを付けて書く。
+
+	標本は各コーデックの配列版(dec_xxx_batch, enc_xxx_batch)で一旦倍精度に
+	直してから符号化する。配列版はCPUに合う版が選ばれる(dispatch.c)。
+	入力が普通のファイルならmmapで読み，パイプならページ境界にそろえた
+	大きなバッファに読む。形式が同じならsplice(Linux)で中身を写すだけにする。
+	目標の1 GB/s (1コア)に届くのはAVX-512でファイルから読むときだけで，
+	ALGO_ISA=baseでは0.57～0.9 GB/s，パイプからパイプへは0.5～1.1 GB/sである
+	(s16 -> ulaw，256 MiB。README)。
+
+	make pcmconv (libalgoc.aとリンクする)
+*******************************************************************************/
+#define _GNU_SOURCE  /* splice() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pio.h"
+#include "probe.h"
+
+#define CHUNK    4096        /* 一度に倍精度に直す標本数 (32KiB) */
+#define BUFSIZE  (1 << 20)   /* 入力・出力のバッファ */
+#define ALIGN    4096
+#define UNKNOWN  UINT64_MAX  /* 長さがわからない */
+
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_ALAW       0x0006
+#define WAVE_FORMAT_MULAW      0x0007
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+typedef struct {
+	const char *name;
+	int tag, bytes;  /* WAVEの形式番号, 1標本のバイト数 */
+	void (* dec)(int, const uint8_t *, double *);
+	void (* enc)(int, const double *, uint8_t *);
+} pcm_format_t;
+
+static const pcm_format_t formats[] =
+{
+	{ "u8",   WAVE_FORMAT_PCM,   1, dec_pcm8bit_batch,  enc_pcm8bit_batch  },
+	{ "s16",  WAVE_FORMAT_PCM,   2, dec_pcm16bit_batch, enc_pcm16bit_batch },
+	{ "s24",  WAVE_FORMAT_PCM,   3, dec_pcm24bit_batch, enc_pcm24bit_batch },
+	{ "s32",  WAVE_FORMAT_PCM,   4, dec_pcm32bit_batch, enc_pcm32bit_batch },
+	{ "ulaw", WAVE_FORMAT_MULAW, 1, dec_pcmu_batch,     enc_pcmu_batch     },
+	{ "alaw", WAVE_FORMAT_ALAW,  1, dec_pcma_batch,     enc_pcma_batch     }
+};
+#define NFORMATS (int)(sizeof formats / sizeof formats[0])
+
+static void
+error(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "pcmconv: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+	exit(1);
+}
+
+static const pcm_format_t *
+format_by_name(const char *s)
+{
+	int i;
+
+	for (i = 0; i < NFORMATS; i++)
+		if (strcmp(formats[i].name, s) == 0)
+			return &formats[i];
+	error("unknown format '%s' (u8, s16, s24, s32, ulaw, alaw)", s);
+	return NULL;
+}
+
+static const pcm_format_t *
+format_by_tag(int tag, int bits)
+{
+	int i;
+
+	for (i = 0; i < NFORMATS; i++)
+		if (formats[i].tag == tag && formats[i].bytes * 8 == bits)
+			return &formats[i];
+	error("unsupported WAVE format 0x%04X, %d bits", tag, bits);
+	return NULL;
+}
+
+static void *
+aligned_buffer(size_t size)
+{
+	void *p;
+
+	if (posix_memalign(&p, ALIGN, size) != 0)
+		error("out of memory");
+	return p;
+}
+
+/*
+ * 入力。普通のファイルは全体をmmapし，p, nが残り全部を指す。
+ * それ以外はbufに読み，p, nがまだ使っていない部分を指す。
+ */
+typedef struct {
+	int fd;
+	uint8_t *map;
+	size_t mapsize;
+	uint8_t *buf;
+	const uint8_t *p;
+	size_t n;
+	int eof;
+} reader_t;
+
+static void
+reader_open(reader_t *r, const char *path)
+{
+	struct stat st;
+
+	memset(r, 0, sizeof *r);
+	if (path == NULL || strcmp(path, "-") == 0)
+		r->fd = STDIN_FILENO;
+	else if ((r->fd = open(path, O_RDONLY)) < 0)
+		error("%s: %s", path, strerror(errno));
+	if (fstat(r->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+	    lseek(r->fd, 0, SEEK_CUR) == 0 &&
+	    (r->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, r->fd, 0)) != MAP_FAILED)
+	{
+		madvise(r->map, st.st_size, MADV_SEQUENTIAL);
+		r->mapsize = st.st_size;
+		r->p = r->map;
+		r->n = r->mapsize;
+		r->eof = 1;
+		return;
+	}
+	r->map = NULL;
+	r->buf = aligned_buffer(BUFSIZE);
+	r->p = r->buf;
+}
+
+/* 使っていない部分がmin (<= BUFSIZE)バイト以上になるまで読む。EOFなら足りなくても返る */
+static size_t
+reader_fill(reader_t *r, size_t min)
+{
+	ssize_t k;
+
+	if (r->n >= min || r->eof)
+		return r->n;
+	memmove(r->buf, r->p, r->n);
+	r->p = r->buf;
+	while (r->n < min && !r->eof)
+	{
+		k = read(r->fd, r->buf + r->n, BUFSIZE - r->n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k < 0)
+			error("read: %s", strerror(errno));
+		if (k == 0)
+			r->eof = 1;
+		r->n += k;
+	}
+	return r->n;
+}
+
+static void
+reader_consume(reader_t *r, size_t k)
+{
+	r->p += k;
+	r->n -= k;
+}
+
+/* kバイト読み飛ばす。EOFに当たれば0 */
+static int
+reader_skip(reader_t *r, uint64_t k)
+{
+	size_t m;
+
+	while (k > 0)
+	{
+		if ((m = reader_fill(r, 1)) == 0)
+			return 0;
+		if (m > k)  m = k;
+		reader_consume(r, m);
+		k -= m;
+	}
+	return 1;
+}
+
+typedef struct {
+	int fd;
+	uint8_t *buf;
+	size_t n;
+} writer_t;
+
+static void
+write_all(int fd, const uint8_t *p, size_t n)
+{
+	ssize_t k;
+
+	while (n > 0)
+	{
+		k = write(fd, p, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k < 0)
+			error("write: %s", strerror(errno));
+		p += k;
+		n -= k;
+	}
+}
+
+static void
+writer_flush(writer_t *w)
+{
+	write_all(w->fd, w->buf, w->n);
+	w->n = 0;
+}
+
+static uint32_t
+le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static unsigned
+le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static uint8_t *
+put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xFF;  p[1] = (v >> 8) & 0xFF;  p[2] = (v >> 16) & 0xFF;  p[3] = v >> 24;
+	return p + 4;
+}
+
+static uint8_t *
+put16(uint8_t *p, unsigned v)
+{
+	p[0] = v & 0xFF;  p[1] = (v >> 8) & 0xFF;
+	return p + 2;
+}
+
+/*
+ * RIFF/WAVEの見出しを読み，dataチャンクの頭まで進める。
+ * WAVEでなければ0を返し，何も読み進めない。
+ */
+static int
+read_wave_header(reader_t *r, const pcm_format_t **fmt, int *channels, long *rate,
+                 uint64_t *datasize)
+{
+	const uint8_t *p;
+	uint32_t size;
+	int tag, bits, havefmt = 0;
+
+	if (reader_fill(r, 12) < 12 || memcmp(r->p, "RIFF", 4) != 0 || memcmp(r->p + 8, "WAVE", 4) != 0)
+		return 0;
+	reader_consume(r, 12);
+	for (;;)
+	{
+		if (reader_fill(r, 8) < 8)
+			error("WAVE: no data chunk");
+		p = r->p;
+		size = le32(p + 4);
+		if (memcmp(p, "data", 4) == 0)
+		{
+			if (!havefmt)
+				error("WAVE: data chunk before fmt chunk");
+			reader_consume(r, 8);
+			/* 流しながら書かれたものは長さが0か0xFFFFFFFF */
+			*datasize = (size == 0 || size == 0xFFFFFFFF) ? UNKNOWN : size;
+			return 1;
+		}
+		if (memcmp(p, "fmt ", 4) == 0)
+		{
+			if (size < 16 || size > 64 || reader_fill(r, 8 + size) < 8 + size)
+				error("WAVE: broken fmt chunk");
+			p = r->p + 8;
+			tag = le16(p);
+			if (tag == WAVE_FORMAT_EXTENSIBLE && size >= 40)
+				tag = le16(p + 24);  /* SubFormatのGUIDの頭 */
+			*channels = le16(p + 2);
+			*rate = le32(p + 4);
+			bits = le16(p + 14);
+			*fmt = format_by_tag(tag, bits);
+			havefmt = 1;
+		}
+		reader_consume(r, 8);
+		if (!reader_skip(r, (uint64_t)size + (size & 1)))  /* チャンクは偶数バイトにそろえる */
+			error("WAVE: truncated");
+	}
+}
+
+/*
+ * WAVEの見出しを書く。datasizeがUNKNOWNなら長さは0xFFFFFFFFにしておく
+ * (出力がシークできれば最後に書き直す)。PCM以外はfmtを18バイトにしてfactを付ける。
+ */
+static size_t
+wave_header(uint8_t *h, const pcm_format_t *fmt, int channels, long rate, uint64_t datasize)
+{
+	uint8_t *p = h;
+	int pcm = fmt->tag == WAVE_FORMAT_PCM;
+	uint32_t size = datasize > 0xFFFFFFFF - 58 ? 0xFFFFFFFF : (uint32_t)datasize;
+	size_t hsize = pcm ? 44 : 58;
+
+	memcpy(p, "RIFF", 4);
+	p = put32(p + 4, size == 0xFFFFFFFF ? size : size + (uint32_t)hsize - 8 + (size & 1));
+	memcpy(p, "WAVEfmt ", 8);
+	p = put32(p + 8, pcm ? 16 : 18);
+	p = put16(p, fmt->tag);
+	p = put16(p, channels);
+	p = put32(p, (uint32_t)rate);
+	p = put32(p, (uint32_t)rate * channels * fmt->bytes);
+	p = put16(p, channels * fmt->bytes);
+	p = put16(p, fmt->bytes * 8);
+	if (!pcm)
+	{
+		p = put16(p, 0);
+		memcpy(p, "fact", 4);
+		p = put32(p + 4, 4);
+		p = put32(p, size == 0xFFFFFFFF ? size : size / (channels * fmt->bytes));
+	}
+	memcpy(p, "data", 4);
+	p = put32(p + 4, size);
+	return p - h;
+}
+
+/* 形式が同じとき: 中身をそのまま写す。パイプが絡めばspliceでカーネルの中だけで */
+static uint64_t
+copy_through(reader_t *r, writer_t *w, uint64_t len)
+{
+	uint64_t done = 0;
+	size_t m;
+#ifdef __linux__
+	ssize_t k;
+#endif
+
+	writer_flush(w);
+	if (r->n > 0 || r->map != NULL)  /* 読んである分(mmapなら全部) */
+	{
+		m = r->n < len ? r->n : len;
+		write_all(w->fd, r->p, m);
+		reader_consume(r, m);
+		done += m;
+	}
+#ifdef __linux__
+	while (done < len && !r->eof)
+	{
+		k = splice(r->fd, NULL, w->fd, NULL, len - done < BUFSIZE ? len - done : BUFSIZE,
+		           SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k < 0)  /* どちらもパイプでない，など */
+			break;
+		if (k == 0)
+			r->eof = 1;
+		done += k;
+	}
+#endif
+	while (done < len && (m = reader_fill(r, 1)) > 0)
+	{
+		if (m > len - done)  m = len - done;
+		write_all(w->fd, r->p, m);
+		reader_consume(r, m);
+		done += m;
+	}
+	return done;
+}
+
+/* 変換: CHUNK標本ずつ倍精度に直して符号化し，出力のバッファにためる */
+static uint64_t
+convert(reader_t *r, writer_t *w, const pcm_format_t *in, const pcm_format_t *out, uint64_t len)
+{
+	static double s[CHUNK] __attribute__((aligned(64)));
+	uint64_t done = 0;
+	size_t avail;
+	int k;
+
+	while (done < len)
+	{
+		avail = reader_fill(r, in->bytes);
+		if (avail > len - done)  avail = len - done;
+		if ((k = avail / in->bytes) == 0)
+			break;
+		if (k > CHUNK)  k = CHUNK;
+		if (w->n + (size_t)k * out->bytes > BUFSIZE)
+			writer_flush(w);
+		in->dec(k, r->p, s);
+		out->enc(k, s, w->buf + w->n);
+		w->n += (size_t)k * out->bytes;
+		reader_consume(r, (size_t)k * in->bytes);
+		done += (uint64_t)k * in->bytes;
+	}
+	writer_flush(w);
+	if (r->n > 0 && done < len && r->eof)
+		fprintf(stderr, "pcmconv: warning: %zu trailing bytes (less than a sample) dropped\n", r->n);
+	return done / in->bytes;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	        "usage: pcmconv [-f format] -t format [-w] [-c channels] [-r rate] [-o output] [-v] [input]\n"
+	        "  format: u8 s16 s24 s32 ulaw alaw\n"
+	        "  -f  format of raw input (WAVE input is detected)\n"
+	        "  -t  format of output\n"
+	        "  -w  write a WAVE header\n"
+	        "  -c, -r  channels and sample rate of raw input for the header (1, 8000)\n"
+	        "  -v  print the number of samples (and the counters of -DALGO_PROBE)\n");
+	exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const pcm_format_t *in = NULL, *out = NULL;
+	const char *outpath = NULL;
+	int c, wave = 0, verbose = 0, channels = 1;
+	long rate = 8000;
+	uint64_t datasize = UNKNOWN, samples;
+	uint8_t header[64];
+	size_t hsize;
+	off_t start;
+	reader_t r;
+	writer_t w;
+
+	while ((c = getopt(argc, argv, "f:t:wc:r:o:v")) != -1)
+		switch (c) {
+		case 'f':  in = format_by_name(optarg);  break;
+		case 't':  out = format_by_name(optarg);  break;
+		case 'w':  wave = 1;  break;
+		case 'c':  channels = atoi(optarg);  break;
+		case 'r':  rate = atol(optarg);  break;
+		case 'o':  outpath = optarg;  break;
+		case 'v':  verbose = 1;  break;
+		default:   usage();
+		}
+	if (out == NULL || optind + 1 < argc || channels <= 0 || rate <= 0)
+		usage();
+
+	reader_open(&r, optind < argc ? argv[optind] : NULL);
+	if (!read_wave_header(&r, &in, &channels, &rate, &datasize))
+	{
+		if (in == NULL)
+			error("input is not WAVE; give the format with -f");
+		if (r.map != NULL)
+			datasize = r.mapsize;
+	}
+	if (r.map != NULL && datasize > r.n)  /* 途中で切れたファイル */
+		datasize = r.n;
+
+	if (outpath == NULL || strcmp(outpath, "-") == 0)
+		w.fd = STDOUT_FILENO;
+	else if ((w.fd = open(outpath, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+		error("%s: %s", outpath, strerror(errno));
+	w.buf = aligned_buffer(BUFSIZE);
+	w.n = 0;
+	start = lseek(w.fd, 0, SEEK_CUR);  /* パイプなら-1 */
+	if (wave)
+	{
+		hsize = wave_header(header, out, channels, rate,
+		                    datasize == UNKNOWN ? UNKNOWN : datasize / in->bytes * out->bytes);
+		memcpy(w.buf, header, hsize);
+		w.n = hsize;
+	}
+
+	if (in == out)
+		samples = copy_through(&r, &w, datasize) / in->bytes;
+	else
+		samples = convert(&r, &w, in, out, datasize);
+
+	if (wave && (samples * out->bytes) & 1)  /* チャンクは偶数バイトにそろえる */
+		write_all(w.fd, (const uint8_t *)"", 1);
+	/* 見出しの長さは見込みなので(流れてくる入力，途中で切れた入力)，
+	 * シークできれば実際の長さで書き直す */
+	if (wave && start >= 0)
+	{
+		hsize = wave_header(header, out, channels, rate, samples * out->bytes);
+		if (pwrite(w.fd, header, hsize, start) != (ssize_t)hsize)
+			error("write: %s", strerror(errno));
+	}
+	if (w.fd != STDOUT_FILENO && close(w.fd) != 0)
+		error("%s: %s", outpath, strerror(errno));
+	if (verbose)
+	{
+		probe_snapshot_t ps;
+
+		fprintf(stderr, "pcmconv: %s -> %s, %llu samples\n", in->name, out->name,
+		        (unsigned long long)samples);
+		if (probe_snapshot(&ps) == 0)
+		{
+			probe_export_json(stderr, &ps);
+			fprintf(stderr, "\n");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*******************************************************************************
+	pio.h -- パルス符号変調の公開ヘッダ
+	codec_pcm.c, codec_pcmu.c, codec_pcma.cが共有するブローカー(pio_broker_t)と
+	符号化・復号の表。符号化器が使う飽和変換はpio_sat.h (入れない)にある。
+*******************************************************************************/
+#ifndef PIO_H
+#define PIO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef volatile double io_snddata_t;
+typedef volatile uint8_t io_bindata_t;
+
+typedef struct {
+	io_snddata_t s;
+	io_bindata_t b1;
+	io_bindata_t b2;
+	io_bindata_t b3;
+	io_bindata_t b4;
+} pio_broker_t;
+
+#define DECODE 0
+#define ENCODE 1
+
+/* Codec's Singleton Functions
+Declare of Callback function of codecs
+typedef void (* codec_ptr[CODEC_PATT][CODEC_TYPE])(pio_broker_t *);
+CODEC_PATT .. 0 is Decode, 1 is Encode. Use constant DECODE / ENCODE
+CODEC_TYPE .. Each these format of type
+ */
+
+/* Wave format information is crowds into main function as a parameter setting */
+
+//0x0001  WAVE_FORMAT_PCM
+#define LINEAR_PCM8   0
+#define LINEAR_PCM16  1
+#define LINEAR_PCM24  2
+#define LINEAR_PCM32  3
+
+void dec_pcm8bit(pio_broker_t*);
+void dec_pcm16bit(pio_broker_t*);
+void dec_pcm24bit(pio_broker_t*);
+void dec_pcm32bit(pio_broker_t*);
+void enc_pcm8bit(pio_broker_t*);
+void enc_pcm16bit(pio_broker_t*);
+void enc_pcm24bit(pio_broker_t*);
+void enc_pcm32bit(pio_broker_t*);
+
+typedef void (* lpcmcodec_tab[2][4])(pio_broker_t *);
+extern const lpcmcodec_tab lpcm_codec;
+
+/* Bulk versions: len samples, b[] is the byte stream of the format */
+void dec_pcm8bit_batch(int, const uint8_t *, double *);
+void dec_pcm16bit_batch(int, const uint8_t *, double *);
+void dec_pcm24bit_batch(int, const uint8_t *, double *);
+void dec_pcm32bit_batch(int, const uint8_t *, double *);
+void enc_pcm8bit_batch(int, const double *, uint8_t *);
+void enc_pcm16bit_batch(int, const double *, uint8_t *);
+void enc_pcm24bit_batch(int, const double *, uint8_t *);
+void enc_pcm32bit_batch(int, const double *, uint8_t *);
+
+//0x0006  WAVE_FORMAT_PCMA
+void dec_pcma(pio_broker_t*);
+void enc_pcma(pio_broker_t*);
+void dec_pcma_batch(int, const uint8_t *, double *);
+void enc_pcma_batch(int, const double *, uint8_t *);
+
+typedef void (* pcmacodec_tab[2][1])(pio_broker_t *);
+extern const pcmacodec_tab pcma_codec;
+
+//0x0007  WAVE_FORMAT_PCMU
+void dec_pcmu(pio_broker_t*);
+void enc_pcmu(pio_broker_t*);
+void dec_pcmu_batch(int, const uint8_t *, double *);
+void enc_pcmu_batch(int, const double *, uint8_t *);
+
+typedef void (* pcmucodec_tab[2][1])(pio_broker_t *);
+extern const pcmucodec_tab pcmu_codec;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIO_H */
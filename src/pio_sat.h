@@ -0,0 +1,79 @@
+/*******************************************************************************
+	pio_sat.h -- パルス符号変調の符号化器が使う飽和変換 (内部用)
+	codec_pcm.c, codec_pcmu.c, codec_pcma.cだけが取り込む。名前に接頭辞の
+	ない小さな関数なので，make installでは入れない。
+*******************************************************************************/
+#ifndef PIO_SAT_H
+#define PIO_SAT_H
+
+#include <stdint.h>
+
+/*
+ * Saturating float-to-integer conversion.
+ * v is a signed sound datum already scaled to the integer grid
+ * (e.g. 16bit: s * 32768.0). It is rounded half up, i.e. floor(v + 0.5),
+ * and saturated to the range of the format. Behavior for the special values:
+ *   +inf -> maximum, -inf -> minimum, NaN -> 0 (silence)
+ * The bias moves [lo - 0.5, hi + 0.5) onto [0, hi - lo + 1), where truncation
+ * equals floor, so floor() is not required. The sum v + bias is itself
+ * rounded to the double grid near bias, whose step is 2^-45 (8bit), 2^-37
+ * (16bit), 2^-29 (24bit) and 2^-21 (32bit); a v within half a step below
+ * a half-way point therefore rounds up, e.g. 24 and 32bit v = 0.5 - 2^-30 gives 1.
+ * The error is far below the resolution of any sound datum.
+ * The selects become max, min and a mask, thus a loop over these is
+ * vectorized as is and gives bit for bit the same result as the scalar one. NaN is tested last on the input, apart
+ * from the clamp: checking it first makes GCC merge the three selects into
+ * one predicate, which is twice as slow in a vectorized loop.
+ */
+static inline double
+sat_bias(double v, double bias, double top)
+{
+	double t = v + bias;
+
+	t = (t > 0.0) ? t : 0.0; /* -inf and underflow (NaN too, for now) */
+	t = (t < top) ? t : top; /* +inf and overflow */
+	return (v == v) ? t : bias; /* NaN -> 0 */
+}
+
+/* True if sat_bias() above saturates v: v + bias is NaN or outside [0, top + 1).
+ * Only the counters of probe.h (-DALGO_PROBE) use this; the bulk encoders
+ * tally it in their saturating loop (PROBE_TALLY), where v + bias is shared. */
+static inline int
+sat_clipped(double v, double bias, double top)
+{
+	double t = v + bias, c;
+
+	/* Two double selects and a conversion, as in sat_bias(): a bool from
+	 * && (a branch) or & (a 64bit mask to int) does not vectorize with SSE2 */
+	c = (t >= 0.0) ? 0.0 : 1.0;     /* -inf, underflow and NaN */
+	c = (t < top + 1.0) ? c : 1.0;  /* +inf and overflow */
+	return (int)c;
+}
+
+/* 8bit is offset binary: -128 .. 127 -> 0x00 .. 0xFF */
+static inline uint8_t
+sat_round_to_u8(double v)
+{
+	return (uint8_t)(int32_t)sat_bias(v, 128.5, 255.0);
+}
+
+static inline int16_t
+sat_round_to_s16(double v)
+{
+	return (int16_t)((int32_t)sat_bias(v, 32768.5, 65535.0) - 32768);
+}
+
+static inline int32_t
+sat_round_to_s24(double v)
+{
+	return (int32_t)sat_bias(v, 8388608.5, 16777215.0) - 8388608;
+}
+
+/* 2^32-1 does not fit in int32_t, so truncation goes through int64_t */
+static inline int32_t
+sat_round_to_s32(double v)
+{
+	return (int32_t)((int64_t)sat_bias(v, 2147483648.5, 4294967295.0) - INT64_C(2147483648));
+}
+
+#endif /* PIO_SAT_H */
@@ -0,0 +1,467 @@
+/*******************************************************************************
+	power.c -- 累乗
+	※奥村教授の事典の追補。power.txtの負の底の累乗をコードにする
+*******************************************************************************/
+#include <math.h> /* pow(), fabs(), copysign() */
+#include <limits.h>
+#include "algomath.h"
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* $ab = p + e$を正確に分ける。FMAが無ければDekkerの分割 */
+static inline double
+two_prod(double a, double b, double *e)
+{
+	double p = a * b;
+#ifdef __FMA__
+	*e = fma(a, b, -p);
+#else
+	const double split = 134217729.0; /* $2^{27} + 1$ */
+	double t, ah, al, bh, bl;
+
+	t = split * a;  ah = t - (t - a);  al = a - ah;
+	t = split * b;  bh = t - (t - b);  bl = b - bh;
+	*e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+	return p;
+}
+
+/* 二進法(繰り返し二乗法)による$x^n$
+ * 指数のビットを下から見て，立っていれば掛け，底は毎回二乗する。掛け算は
+ * $2\log_2 n$回ほどで済むが，二乗のたびに相対誤差も倍になるので，素朴に回すと
+ * 誤差は$n/2$ ulpほどまで育つ($n = 100$で約40 ulp)。そこで積と底を
+ * 上位と下位の2つの倍精度数で持ち，掛け算の丸め誤差を下位に拾う
+ * (Graillatの補償つき累乗)。$n$によらず1 ulp程度に収まる。
+ * 負の指数は$1/x^{|n|}$とするが，$x^{|n|}$があふれたら(答えは非正規数かもしれない)
+ * pow()に任せる。負の底は掛け算のまま符号が決まる。
+ * 上位が無限大(あふれ，無限大の底)なら下位は$\infty - \infty$のNaNなので足さず，
+ * 下位が0なら$-0$の符号を残すために足さない(pw_sum())。
+ */
+static inline double
+pw_sum(double rh, double rl)
+{
+	return (rl == 0 || !isfinite(rh)) ? rh : rh + rl;
+}
+
+static inline double
+powi_loop(double x, int n)
+{
+	unsigned m = n < 0 ? 0u - (unsigned)n : (unsigned)n;
+	double rh = 1.0, rl = 0.0, bh = x, bl = 0.0, e;
+
+#ifndef __FMA__
+	if (m > 64)  /* Dekkerの分割では大きなnでpow()より遅くなる */
+		return pow(x, n);
+#endif
+	for (;;)
+	{
+		if (m & 1)
+		{
+			double p = two_prod(rh, bh, &e);
+			rl = e + (rh * bl + rl * bh);
+			rh = p;
+		}
+		if ((m >>= 1) == 0)
+			break;
+		e = 2 * bh * bl;
+		bh = two_prod(bh, bh, &bl);
+		bl += e;
+	}
+	rh = pw_sum(rh, rl);
+	if (n >= 0)
+		return rh;
+	return fabs(rh) < HUGE_VAL ? 1.0 / rh : pow(x, n);
+}
+
+/* 整数の指数の累乗$x^n$
+ * $|n| \leq 4$はalgomath.hのpowi_inline()の書き下し(素朴な積でも1.5 ulp以内，
+ * 逆数を取るとさらに0.5 ulp)。powi()はalgomath.hでpowi_inline()に置き換わるので，
+ * 呼び出し側で展開されるのはnが定数のときで，ここに来るのは関数のアドレスを
+ * 取って呼んだときと$|n| > 4$のときである。powi_batch()も同じ手順で書き下す。
+ */
+double
+(powi)(double x, int n)
+{
+	return n >= -4 && n <= 4 ? powi_inline(x, n) : powi_loop(x, n);
+}
+
+/* 最大公約数 */
+static int
+gcd(int a, int b)
+{
+	while (b)
+	{
+		int t = a % b;
+		a = b;  b = t;
+	}
+	return a;
+}
+
+/* 有理数の指数の累乗$x^{p/q}$
+ * power.txtのとおり，負の底は$|x|$で計算して符号を付け直す。約分した$q$が奇数なら
+ * 実数の$q$乗根があり，符号は$(-1)^p$となる。$q$が偶数なら実数の解はなくNaN。
+ * $q = 1$は整数の累乗，$q = 2, 3$はsqrt(), cbrt()を使う。
+ */
+double
+pow_ratio(double x, int p, int q)
+{
+	double a, r;
+	int g;
+
+	if (q == 0 || p == INT_MIN || q == INT_MIN)  /* 符号を反転できない */
+		return NAN;
+	if (q < 0)
+	{
+		p = -p;  q = -q;
+	}
+	g = gcd(p < 0 ? -p : p, q);
+	if (g > 1)
+	{
+		p /= g;  q /= g;
+	}
+	if (q == 1)
+		return powi(x, p);
+	if (x < 0 && q % 2 == 0)
+		return NAN;  /* 負の数の偶数乗根 */
+	a = fabs(x);
+	switch (q) {
+	case 2:  r = powi(sqrt(a), p); break;
+	case 3:  r = powi(cbrt(a), p); break;
+	default: r = pow(a, (double)p / q); break;
+	}
+	return x < 0 && (p & 1) ? -r : r;
+}
+
+/* 負の底に対応した累乗$x^y$
+ * $y$が整数ならpowi()に回す(速く，負の底の符号も掛け算のまま決まる)。
+ * 整数でない$y$は，$y = p/q$ ($q$は3, 5, 7, ...の奇数，$q \leq 15$)と正確に
+ * 表せればpow_ratio()で実数の根をとる。それ以外はpow()と同じ(負の底はNaN)。
+ */
+double
+pow_signed(double x, double y)
+{
+	int q;
+
+	if (fabs(y) <= INT_MAX && y == (int)y)  /* 範囲を先に見る(NaNもここで落ちる) */
+		return powi(x, (int)y);
+	if (x < 0 && isfinite(y))
+		for (q = 3; q <= 15; q += 2)
+		{
+			double p = y * q;
+			if (fabs(p) <= INT_MAX && p == (int)p && p / q == y)
+				return pow_ratio(x, (int)p, q);
+		}
+	return pow(x, y);
+}
+
+/*******************************************************************************
+	配列版
+	指数が全要素で同じなので，ビットの分岐はレーンによらず一様になる。
+	1本のベクトルに対して同じ手順で掛け算するだけである。
+*******************************************************************************/
+#if defined(__AVX512F__)
+#define PW_VLEN 8
+typedef __m512d pw_vec_t;
+#define pw_set1(a)      _mm512_set1_pd(a)
+#define pw_add(a, b)    _mm512_add_pd(a, b)
+#define pw_sub(a, b)    _mm512_sub_pd(a, b)
+#define pw_mul(a, b)    _mm512_mul_pd(a, b)
+#define pw_fmsub(a, b, c) _mm512_fmsub_pd(a, b, c)
+#define pw_div(a, b)    _mm512_div_pd(a, b)
+#define pw_load(p)      _mm512_loadu_pd(p)
+#define pw_store(p, a)  _mm512_storeu_pd(p, a)
+#define pw_all_finite(a) \
+	(_mm512_cmp_pd_mask(_mm512_abs_pd(a), pw_set1(HUGE_VAL), _CMP_LT_OQ) == 0xFF)
+/* pw_sum()のベクトル版 */
+#define pw_vsum(h, l) \
+	_mm512_mask_add_pd(h, _mm512_cmp_pd_mask(l, pw_set1(0.0), _CMP_NEQ_UQ) & \
+	                      _mm512_cmp_pd_mask(_mm512_abs_pd(h), pw_set1(HUGE_VAL), _CMP_LT_OQ), h, l)
+#elif defined(__AVX2__)
+#define PW_VLEN 4
+typedef __m256d pw_vec_t;
+#define pw_set1(a)      _mm256_set1_pd(a)
+#define pw_add(a, b)    _mm256_add_pd(a, b)
+#define pw_sub(a, b)    _mm256_sub_pd(a, b)
+#define pw_mul(a, b)    _mm256_mul_pd(a, b)
+#define pw_fmsub(a, b, c) _mm256_fmsub_pd(a, b, c)
+#define pw_div(a, b)    _mm256_div_pd(a, b)
+#define pw_load(p)      _mm256_loadu_pd(p)
+#define pw_store(p, a)  _mm256_storeu_pd(p, a)
+#define pw_all_finite(a) \
+	(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(pw_set1(-0.0), a), \
+	                                  pw_set1(HUGE_VAL), _CMP_LT_OQ)) == 0xF)
+#define pw_vsum(h, l) \
+	_mm256_blendv_pd(h, _mm256_add_pd(h, l), \
+	                 _mm256_and_pd(_mm256_cmp_pd(l, pw_set1(0.0), _CMP_NEQ_UQ), \
+	                               _mm256_cmp_pd(_mm256_andnot_pd(pw_set1(-0.0), h), \
+	                                             pw_set1(HUGE_VAL), _CMP_LT_OQ)))
+#endif
+
+#ifdef PW_VLEN
+/* two_prod()のベクトル版 */
+static inline pw_vec_t
+pw_two_prod(pw_vec_t a, pw_vec_t b, pw_vec_t *e)
+{
+	pw_vec_t p = pw_mul(a, b);
+#ifdef __FMA__
+	*e = pw_fmsub(a, b, p);
+#else
+	const pw_vec_t split = pw_set1(134217729.0);
+	pw_vec_t t, ah, al, bh, bl;
+
+	t = pw_mul(split, a);  ah = pw_sub(t, pw_sub(t, a));  al = pw_sub(a, ah);
+	t = pw_mul(split, b);  bh = pw_sub(t, pw_sub(t, b));  bl = pw_sub(b, bh);
+	*e = pw_add(pw_add(pw_add(pw_sub(pw_mul(ah, bh), p), pw_mul(ah, bl)), pw_mul(al, bh)),
+	            pw_mul(al, bl));
+#endif
+	return p;
+}
+#endif
+
+/* y[i] = powi(x[i], n)。$|n| \leq 4$は書き下し，それ以上は補償つきで */
+void
+powi_batch(int len, const double *x, int n, double *y)
+{
+	int i = 0, j;
+
+#ifdef PW_VLEN
+	const unsigned m0 = n < 0 ? 0u - (unsigned)n : (unsigned)n;
+
+	if (m0 <= 4)
+		for (; i + PW_VLEN <= len; i += PW_VLEN)
+		{
+			pw_vec_t b = pw_load(x + i), r = pw_set1(1.0);
+
+			switch (m0) {
+			case 4: r = pw_mul(b, b);  r = pw_mul(r, r); break;
+			case 3: r = pw_mul(pw_mul(b, b), b); break;
+			case 2: r = pw_mul(b, b); break;
+			case 1: r = b; break;
+			}
+			pw_store(y + i, n < 0 ? pw_div(pw_set1(1.0), r) : r);
+		}
+	else
+		for (; i + PW_VLEN <= len; i += PW_VLEN)
+		{
+			pw_vec_t rh = pw_set1(1.0), rl = pw_set1(0.0), bh = pw_load(x + i), bl = rl, e, p;
+			unsigned m = m0;
+
+			for (;;)
+			{
+				if (m & 1)
+				{
+					p = pw_two_prod(rh, bh, &e);
+					rl = pw_add(e, pw_add(pw_mul(rh, bl), pw_mul(rl, bh)));
+					rh = p;
+				}
+				if ((m >>= 1) == 0)
+					break;
+				e = pw_mul(pw_add(bh, bh), bl);
+				bh = pw_two_prod(bh, bh, &bl);
+				bl = pw_add(bl, e);
+			}
+			rh = pw_vsum(rh, rl);
+			if (n >= 0)
+				pw_store(y + i, rh);
+			else if (pw_all_finite(rh))
+				pw_store(y + i, pw_div(pw_set1(1.0), rh));
+			else  /* あふれたレーンがあればスカラーで */
+				for (j = i; j < i + PW_VLEN; j++)
+					y[j] = powi(x[j], n);
+		}
+#endif
+	for (j = i; j < len; j++)
+		y[j] = powi(x[j], n);
+}
+
+/* out[i] = pow_ratio(x[i], p, q)
+ * ベクトル化するのは約分して$q = 1$(整数の累乗の配列版に回す)と$q = 2$
+ * (sqrt()の後にpowi_batch())だけである。cbrt()にはベクトル版が無いので
+ * $q = 3$を含むそれ以外の$q$は，要素ごとにpow_ratio()を呼ぶ。
+ */
+void
+pow_ratio_batch(int len, const double *x, int p, int q, double *out)
+{
+	int i, g;
+
+	if (p != INT_MIN && q != INT_MIN)  /* INT_MINはpow_ratio()がNaNにする */
+	{
+		if (q < 0)
+		{
+			p = -p;  q = -q;
+		}
+		if (q > 0 && (g = gcd(p < 0 ? -p : p, q)) > 0 && q / g == 1)
+		{
+			powi_batch(len, x, p / g, out);
+			return;
+		}
+		if (q > 0 && q / g == 2)  /* pは奇数。$-0$はfabs()で$+0$にそろえる */
+		{
+			for (i = 0; i < len; i++)
+				out[i] = x[i] < 0 ? NAN : sqrt(fabs(x[i]));
+			powi_batch(len, out, p / g, out);
+			return;
+		}
+	}
+	for (i = 0; i < len; i++)
+		out[i] = pow_ratio(x[i], p, q);
+}
+
+/* out[i] = pow_signed(x[i], y)
+ * ベクトル化するのは整数のyだけで，それ以外は要素ごとにpow_signed()を呼ぶ。
+ */
+void
+pow_signed_batch(int len, const double *x, double y, double *out)
+{
+	int i;
+
+	if (fabs(y) <= INT_MAX && y == (int)y)
+	{
+		powi_batch(len, x, (int)y, out);
+		return;
+	}
+	for (i = 0; i < len; i++)
+		out[i] = pow_signed(x[i], y);
+}
+
+
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> /* memcmp() */
+#include <float.h>
+#include <time.h>
+
+/* 整数の指数: pow()との速さと，powl()に対する誤差。
+ * 無限大・あふれ・$\pm 0$はpow()とビットごとに突き合わせ，食い違いの数を返す */
+static int
+powi_bench(void)
+{
+	enum { LEN = 1 << 16, REP = 32 };
+	static const int ns[] = { 2, 3, 4, 5, 8, 13, 100, 1000, -3, -100 };
+	static double xs[LEN], ys[LEN];
+	volatile double sink = 0;
+	static const double sx[16] = {
+		HUGE_VAL, -HUGE_VAL, 1e200, -1e200, 0.0, -0.0, 1e-200, -1e-200,
+		0x1p-300, -0x1p-300, 0x1p300, -0x1p300, 2.0, -2.0, 1.0, -1.0  /* 積が正確なもの */
+	};
+	static const int sn[] = { 0, 1, 2, 3, 4, 5, 6, 7, 100, 1001, -1, -2, -3, -4, -5, -6, -7, -100, -1001 };
+	double sy[16], e;
+	clock_t c0, c1, c2, c3;
+	int i, j, r, bad = 0;
+
+	for (j = 0; j < (int)(sizeof sn / sizeof sn[0]); j++)
+	{
+		powi_batch(16, sx, sn[j], sy);
+		for (i = 0; i < 16; i++)
+		{
+			double y = powi(sx[i], sn[j]);
+
+			e = pow(sx[i], sn[j]);
+			if (memcmp(&y, &e, sizeof e) || memcmp(&sy[i], &e, sizeof e))
+			{
+				if (bad++ < 8)
+					printf("powi(%g, %d) = %g, batch %g, pow %g\n", sx[i], sn[j], y, sy[i], e);
+			}
+		}
+	}
+	printf("special values: %d mismatches against pow()\n", bad);
+
+	srand(7);
+	for (i = 0; i < LEN; i++)
+		xs[i] = (rand() % 2 ? -1 : 1) * (0.5 + (double)rand() / RAND_MAX);
+	puts("   n  max ulp    pow      powi   powi_batch  (ns/call)");
+	for (j = 0; j < (int)(sizeof ns / sizeof ns[0]); j++)
+	{
+		const int n = ns[j];
+		double err, maxe = 0;
+
+		powi_batch(LEN, xs, n, ys);
+		for (i = 0; i < LEN; i++)  /* 1000乗は$2^{\pm 1000}$ほどまで振れるが倍精度に収まる */
+		{
+			long double e = powl(xs[i], n);
+			err = (double)fabsl(powi(xs[i], n) - e) / (DBL_EPSILON * fabs((double)e));
+			if (err > maxe)  maxe = err;
+			err = (double)fabsl(ys[i] - e) / (DBL_EPSILON * fabs((double)e));
+			if (err > maxe)  maxe = err;
+		}
+		c0 = clock();
+		for (r = 0; r < REP; r++)
+			for (i = 0; i < LEN; i++)  ys[i] = pow(xs[i], n);
+		sink += ys[0];
+		c1 = clock();
+		for (r = 0; r < REP; r++)
+			for (i = 0; i < LEN; i++)  ys[i] = powi(xs[i], n);
+		sink += ys[0];
+		c2 = clock();
+		for (r = 0; r < REP; r++)
+			powi_batch(LEN, xs, n, ys);
+		sink += ys[0];
+		c3 = clock();
+		printf("%4d  %6.2f  %7.2f  %7.2f  %7.2f\n", n, maxe,
+		       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN / REP,
+		       1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN / REP);
+	}
+	return bad;
+}
+
+/* 配列版の有理数乗とpowi_inline()を要素ごとの関数と突き合わせ，食い違いの数を返す。
+ * $q = 2$の配列版はpowi_batch()を通るので4 ulpまで許す。NaNどうしは一致とみなす */
+static int
+pow_batch_check(void)
+{
+	enum { LEN = 64 };
+	static const int pq[][2] = { { 1, 2 }, { 3, 2 }, { -5, 2 }, { 13, 2 }, { -1, -2 }, { 6, 4 }, { 2, 3 }, { 4, 2 } };
+	double (*const f)(double, int) = powi;  /* アドレスを取ればライブラリのpowi() */
+	double xs[LEN], ys[LEN], e, y;
+	int i, j, n, bad = 0;
+
+	for (i = 0; i < LEN; i++)
+		xs[i] = (i % 3 - 1) * 0.37 * (i + 1);
+	xs[0] = -0.0;  xs[1] = 0.0;  xs[2] = NAN;  xs[3] = HUGE_VAL;  xs[4] = -HUGE_VAL;  xs[5] = 1e-310;
+	for (j = 0; j < (int)(sizeof pq / sizeof pq[0]); j++)
+	{
+		pow_ratio_batch(LEN, xs, pq[j][0], pq[j][1], ys);
+		for (i = 0; i < LEN; i++)
+		{
+			e = pow_ratio(xs[i], pq[j][0], pq[j][1]);
+			if (isnan(e) ? !isnan(ys[i]) :
+			    isinf(e) || e == 0 ? memcmp(&e, &ys[i], sizeof e) != 0 :
+			    fabs(ys[i] - e) > 4 * DBL_EPSILON * fabs(e))
+			{
+				if (bad++ < 8)
+					printf("pow_ratio(%g, %d, %d) = %g, batch %g\n", xs[i], pq[j][0], pq[j][1], e, ys[i]);
+			}
+		}
+	}
+	for (n = -6; n <= 6; n++)
+		for (i = 0; i < LEN; i++)
+		{
+			e = f(xs[i], n);  y = powi(xs[i], n);
+			if (memcmp(&e, &y, sizeof e) != 0 && !(isnan(e) && isnan(y)))
+				bad++;
+		}
+	printf("pow_ratio_batch, powi_inline: %d mismatches\n", bad);
+	return bad;
+}
+
+int
+main(void)
+{
+	static const double xs[] = { -8.0, -2.0, -0.5, 0.0, 2.0, 27.0 };
+	static const double ys[] = { 3.0, 2.0, 1.0 / 3, 2.0 / 3, -1.0 / 3, 0.5, 0.4 };
+	int i, j;
+
+	puts("pow_signed(x, y)  (pow(x, y))");
+	for (i = 0; i < (int)(sizeof xs / sizeof xs[0]); i++)
+		for (j = 0; j < (int)(sizeof ys / sizeof ys[0]); j++)
+			printf("  %5g ^ %-9.6g = %-13.10g (%.10g)\n", xs[i], ys[j],
+			       pow_signed(xs[i], ys[j]), pow(xs[i], ys[j]));
+	printf("pow_ratio(-32, 3, 5) = %g, pow_ratio(-4, 1, 2) = %g, pow_ratio(-8, 2, 6) = %g\n",
+	       pow_ratio(-32, 3, 5), pow_ratio(-4, 1, 2), pow_ratio(-8, 2, 6));
+	printf("powi(10, -310) = %g, powi(-3, 7) = %g, powi(2, 1023) = %g\n",
+	       powi(10, -310), powi(-3, 7), powi(2, 1023));
+	return (pow_batch_check() + powi_bench()) != 0;
+}
+#endif /* ALGO_NO_MAIN */
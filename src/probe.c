@@ -0,0 +1,300 @@
+/*******************************************************************************
+	probe.c -- 計数器と時間のヒストグラム
+	スレッドは最初に数えるときに計数器の塊を確保して一覧につなぐ。
+	終了するときは塊の値を「終了したスレッドの分」に足し込んでから外す。
+	probe_snapshot()は一覧を錠の下でたどって足し合わせる。
+
+	-DALGO_PROBEで翻訳したときだけ数える(Makefileではmake PROBE=1)。
+	そうでなければprobe_snapshot()は0を詰めて-1を返す。
+*******************************************************************************/
+#define _POSIX_C_SOURCE 200809L  /* clock_gettime() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "probe.h"
+
+static const char *const counter_name[PROBE_NCOUNTERS] = {
+	"lpcm8_enc", "lpcm16_enc", "lpcm24_enc", "lpcm32_enc",
+	"lpcm8_dec", "lpcm16_dec", "lpcm24_dec", "lpcm32_dec",
+	"pcmu_enc", "pcmu_dec", "pcma_enc", "pcma_dec",
+	"lpcm8_clip", "lpcm16_clip", "lpcm24_clip", "lpcm32_clip",
+	"pcmu_clip", "pcma_clip",
+	"binom_enum", "binom_enum_terms", "binom_exact", "logfact_lgamma",
+	"loggamma", "loggamma_shift", "loggamma_reflect", "loggamma_batch"
+};
+
+static const char *const timer_name[PROBE_NTIMERS] = {
+	"binom_enum", "binom_exact", "loggamma_batch"
+};
+
+const char *
+probe_counter_name(int id)
+{
+	return (id >= 0 && id < PROBE_NCOUNTERS) ? counter_name[id] : NULL;
+}
+
+const char *
+probe_timer_name(int id)
+{
+	return (id >= 0 && id < PROBE_NTIMERS) ? timer_name[id] : NULL;
+}
+
+#ifdef ALGO_PROBE
+__thread probe_block_t *probe_self __attribute__((tls_model("initial-exec")));
+
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+static pthread_key_t probe_key;
+static probe_block_t *probe_list;     /* 生きているスレッドの塊 */
+static probe_snapshot_t probe_retired; /* 終了したスレッドの分 */
+
+/* スレッドの終了時: 値を足し込んで一覧から外す */
+static void
+probe_detach(void *p)
+{
+	probe_block_t *b = p, **q;
+	int i, j;
+
+	pthread_mutex_lock(&probe_lock);
+	for (i = 0; i < PROBE_NCOUNTERS; i++)
+		probe_retired.count[i] += __atomic_load_n(&b->count[i], __ATOMIC_RELAXED);
+	for (i = 0; i < PROBE_NTIMERS; i++)
+		for (j = 0; j < PROBE_NBINS; j++)
+			probe_retired.hist[i][j] += __atomic_load_n(&b->hist[i][j], __ATOMIC_RELAXED);
+	for (q = &probe_list; *q != NULL; q = &(*q)->next)
+		if (*q == b)  {  *q = b->next;  break;  }
+	pthread_mutex_unlock(&probe_lock);
+	probe_self = NULL;
+	free(b);
+}
+
+static void
+probe_key_create(void)
+{
+	pthread_key_create(&probe_key, probe_detach);
+}
+
+/* スレッドの最初の計数で呼ばれる */
+probe_block_t *
+probe_attach(void)
+{
+	probe_block_t *b;
+
+	if (probe_self != NULL)
+		return probe_self;
+	pthread_once(&probe_once, probe_key_create);
+	if ((b = calloc(1, sizeof(probe_block_t))) == NULL)
+	{
+		/* 数えられないが止めはしない。以後このスレッドの分は捨てる。
+		 * probe_selfに置いておけば次からcallocを試し直さず，
+		 * probe_record()もNULLを引かない(一覧にはつながないので和には入らない) */
+		static probe_block_t sink;
+		return probe_self = &sink;
+	}
+	pthread_mutex_lock(&probe_lock);
+	b->next = probe_list;
+	probe_list = b;
+	probe_retired.threads++;
+	pthread_mutex_unlock(&probe_lock);
+	pthread_setspecific(probe_key, b);
+	probe_self = b;
+	return b;
+}
+
+/* 単調な時刻[ns]。0は「測らない」の印なので避ける */
+uint64_t
+probe_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return ((uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec) | 1;
+}
+
+/* 経過時間nsを$\lfloor\log_2 ns\rfloor$のビンに入れる */
+void
+probe_record(int id, uint64_t ns)
+{
+	probe_block_t *b = probe_self != NULL ? probe_self : probe_attach();
+	int bin = ns < 2 ? 0 : 63 - __builtin_clzll(ns);
+
+	if (bin >= PROBE_NBINS)  bin = PROBE_NBINS - 1;
+	__atomic_store_n(&b->hist[id][bin], __atomic_load_n(&b->hist[id][bin], __ATOMIC_RELAXED) + 1,
+	                 __ATOMIC_RELAXED);
+}
+
+/* 全スレッドの和。数えている最中のスレッドは止めないので，
+ * 各計数器はどこかの時点の値で，計数器どうしは同じ時点とは限らない */
+int
+probe_snapshot(probe_snapshot_t *s)
+{
+	probe_block_t *b;
+	int i, j;
+
+	pthread_mutex_lock(&probe_lock);
+	*s = probe_retired;
+	for (b = probe_list; b != NULL; b = b->next)
+	{
+		for (i = 0; i < PROBE_NCOUNTERS; i++)
+			s->count[i] += __atomic_load_n(&b->count[i], __ATOMIC_RELAXED);
+		for (i = 0; i < PROBE_NTIMERS; i++)
+			for (j = 0; j < PROBE_NBINS; j++)
+				s->hist[i][j] += __atomic_load_n(&b->hist[i][j], __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&probe_lock);
+	return 0;
+}
+
+/* 0に戻す。他のスレッドが数えている最中なら，その1回分は残ることがある */
+void
+probe_reset(void)
+{
+	probe_block_t *b;
+	unsigned long threads;
+	int i, j;
+
+	pthread_mutex_lock(&probe_lock);
+	threads = probe_retired.threads;
+	memset(&probe_retired, 0, sizeof probe_retired);
+	probe_retired.threads = threads;
+	for (b = probe_list; b != NULL; b = b->next)
+	{
+		for (i = 0; i < PROBE_NCOUNTERS; i++)
+			__atomic_store_n(&b->count[i], 0, __ATOMIC_RELAXED);
+		for (i = 0; i < PROBE_NTIMERS; i++)
+			for (j = 0; j < PROBE_NBINS; j++)
+				__atomic_store_n(&b->hist[i][j], 0, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&probe_lock);
+}
+#else
+int
+probe_snapshot(probe_snapshot_t *s)
+{
+	memset(s, 0, sizeof *s);
+	return -1;
+}
+
+void
+probe_reset(void)
+{
+}
+#endif /* ALGO_PROBE */
+
+/* JSONで書き出す。ヒストグラムは0でないビンだけ[下端ns, 回数]で */
+int
+probe_export_json(FILE *fp, const probe_snapshot_t *s)
+{
+	int i, j, first;
+
+	fprintf(fp, "{\"threads\": %lu, \"counters\": {", s->threads);
+	for (i = 0; i < PROBE_NCOUNTERS; i++)
+		fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", counter_name[i],
+		        (unsigned long long)s->count[i]);
+	fprintf(fp, "}, \"timers_ns\": {");
+	for (i = 0; i < PROBE_NTIMERS; i++)
+	{
+		fprintf(fp, "%s\"%s\": [", i ? ", " : "", timer_name[i]);
+		for (first = 1, j = 0; j < PROBE_NBINS; j++)
+			if (s->hist[i][j] != 0)
+			{
+				fprintf(fp, "%s[%llu, %llu]", first ? "" : ", ",
+				        j ? 1ull << j : 0ull, (unsigned long long)s->hist[i][j]);
+				first = 0;
+			}
+		fprintf(fp, "]");
+	}
+	fprintf(fp, "}}");
+	return ferror(fp) ? -1 : 0;
+}
+
+
+/******************************************************************************/
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+// 以下はテスト: 複数のスレッドで数えて和が合うか (libalgoc.aとリンクする)
+#include "algomath.h"
+#include "pio.h"
+
+#define NTHREAD 4
+#define NSAMPLE 10000
+
+/* 1スレッド分: PCM16とμ-lawをNSAMPLE個ずつ(うち1/10は範囲外)，
+ * loggammaを$x = 0.5, 1.5, \ldots$と$-10.5$で，2項分布を2回 */
+static void *
+worker(void *arg)
+{
+	pio_broker_t bro;
+	binom_param_t param;
+	double v;
+	int i;
+
+	(void)arg;
+	for (i = 0; i < NSAMPLE; i++)
+	{
+		v = (i % 10 == 0) ? 1.5 : (i - NSAMPLE / 2) / (double)NSAMPLE;
+		bro.s = v;
+		lpcm_codec[ENCODE][LINEAR_PCM16](&bro);
+		lpcm_codec[DECODE][LINEAR_PCM16](&bro);
+		bro.s = v;
+		pcmu_codec[ENCODE][0](&bro);
+	}
+	for (i = 0; i < 16; i++)
+		loggamma(i + 0.5);
+	loggamma(-10.5);
+	binom_enum_initialize(20, 0.3, &param);
+	binom_enum_initialize(1000, 0.5, &param);
+	return NULL;
+}
+
+int
+main(void)
+{
+	pthread_t th[NTHREAD];
+	probe_snapshot_t s;
+	int i, bad = 0;
+
+	if (probe_snapshot(&s) != 0)
+	{
+		printf("probes disabled (build with -DALGO_PROBE)\n");
+		return 0;
+	}
+	for (i = 0; i < NTHREAD; i++)
+		pthread_create(&th[i], NULL, worker, NULL);
+	for (i = 0; i < NTHREAD; i++)
+		pthread_join(th[i], NULL);
+	worker(NULL);  /* 生きているスレッドの分 */
+	probe_snapshot(&s);
+	probe_export_json(stdout, &s);
+	printf("\n");
+
+#define EXPECT(id, v) \
+	if (s.count[id] != (uint64_t)(v)) \
+	{ \
+		printf("%s: %llu, expected %llu\n", probe_counter_name(id), \
+		       (unsigned long long)s.count[id], (unsigned long long)(v)); \
+		bad++; \
+	}
+	EXPECT(PROBE_LPCM16_ENC, (NTHREAD + 1) * NSAMPLE);
+	EXPECT(PROBE_LPCM16_DEC, (NTHREAD + 1) * NSAMPLE);
+	EXPECT(PROBE_PCMU_ENC, (NTHREAD + 1) * NSAMPLE);
+	EXPECT(PROBE_LPCM16_CLIP, (NTHREAD + 1) * NSAMPLE / 10);
+	EXPECT(PROBE_PCMU_CLIP, (NTHREAD + 1) * NSAMPLE / 10);
+	EXPECT(PROBE_LOGGAMMA, (NTHREAD + 1) * 9);      /* 8.5, ..., 15.5と相反公式の11.5 */
+	EXPECT(PROBE_LOGGAMMA_SHIFT, (NTHREAD + 1) * 8); /* 0.5, ..., 7.5 */
+	EXPECT(PROBE_LOGGAMMA_REFLECT, (NTHREAD + 1));
+	EXPECT(PROBE_BINOM_ENUM, (NTHREAD + 1) * 2);
+	if (s.threads != NTHREAD + 1)
+	{
+		printf("threads: %lu, expected %d\n", s.threads, NTHREAD + 1);
+		bad++;
+	}
+
+	probe_reset();
+	probe_snapshot(&s);
+	EXPECT(PROBE_LPCM16_ENC, 0);
+#undef EXPECT
+	return bad != 0;
+}
+#endif /* ALGO_NO_MAIN */
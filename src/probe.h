@@ -0,0 +1,123 @@
+/*******************************************************************************
+	probe.h -- 計数器と時間のヒストグラム (-DALGO_PROBEのときだけ)
+	符号化・復号した標本数，飽和した標本数，2項分布で近似をあきらめて
+	厳密な和に回った回数，loggammaがずらしのループを回った回数などを
+	スレッドごとに数え，probe_snapshot()で全スレッドの和を取り出す。
+	-DALGO_PROBEなしではPROBE_COUNT()などは何もしない式になり，
+	計る側のコードには何も残らない(probe_snapshot()は-1を返す)。
+*******************************************************************************/
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 計数器 */
+enum {
+	PROBE_LPCM8_ENC, PROBE_LPCM16_ENC, PROBE_LPCM24_ENC, PROBE_LPCM32_ENC,
+	PROBE_LPCM8_DEC, PROBE_LPCM16_DEC, PROBE_LPCM24_DEC, PROBE_LPCM32_DEC,
+	PROBE_PCMU_ENC, PROBE_PCMU_DEC, PROBE_PCMA_ENC, PROBE_PCMA_DEC,  /* 標本数 */
+	PROBE_LPCM8_CLIP, PROBE_LPCM16_CLIP, PROBE_LPCM24_CLIP, PROBE_LPCM32_CLIP,
+	PROBE_PCMU_CLIP, PROBE_PCMA_CLIP,  /* 範囲外かNaNで飽和した標本数 */
+	PROBE_BINOM_ENUM,          /* binom_enum_initialize()の呼び出し */
+	PROBE_BINOM_ENUM_TERMS,    /* そのとき正規化のために歩いた項の数 */
+	PROBE_BINOM_EXACT,         /* 近似エンジンがbinompmf/binomcdfに回った回数 */
+	PROBE_LOGFACT_LGAMMA,      /* logfact()が表を越えてlgamma_rに回った回数 */
+	PROBE_LOGGAMMA,            /* loggamma(): ずらしなし($x \geq N$) */
+	PROBE_LOGGAMMA_SHIFT,      /* loggamma(): $x < N$でずらしのループを回った */
+	PROBE_LOGGAMMA_REFLECT,    /* loggamma(): $x < -N$で相反公式。$1-x$の方は上で数える */
+	PROBE_LOGGAMMA_BATCH,      /* loggamma_batch()の要素数 */
+	PROBE_NCOUNTERS
+};
+
+/* 時間のヒストグラム。ビンbは$[2^b, 2^{b+1})$ ns，ビン0は2ns未満 */
+enum {
+	PROBE_T_BINOM_ENUM,        /* binom_enum_initialize() */
+	PROBE_T_BINOM_EXACT,       /* 近似エンジンの厳密な計算 */
+	PROBE_T_LOGGAMMA_BATCH,    /* loggamma_batch() 1回 */
+	PROBE_NTIMERS
+};
+#define PROBE_NBINS   32
+#define PROBE_SAMPLE  64  /* 時間はスレッドごとにこの回数に1回だけ測る */
+
+typedef struct ProbeSnapshot {
+	uint64_t count[PROBE_NCOUNTERS];
+	uint64_t hist[PROBE_NTIMERS][PROBE_NBINS];
+	unsigned long threads;  /* 数えたことのあるスレッド(終了したものも含む) */
+} probe_snapshot_t ;
+
+int probe_snapshot(probe_snapshot_t *);
+void probe_reset(void);
+int probe_export_json(FILE *, const probe_snapshot_t *);
+const char *probe_counter_name(int);
+const char *probe_timer_name(int);
+
+#ifdef ALGO_PROBE
+/*
+ * スレッドごとの計数器の塊。書くのは持ち主のスレッドだけなので，
+ * 加算はロックなしの読んで足して書く(relaxed)で済む。probe_snapshot()は
+ * 他のスレッドからrelaxedで読むだけで，スレッドは止めない。
+ */
+typedef struct ProbeBlock {
+	uint64_t count[PROBE_NCOUNTERS];   /* __atomic_*で読み書きする */
+	uint64_t hist[PROBE_NTIMERS][PROBE_NBINS];
+	unsigned tick[PROBE_NTIMERS];
+	struct ProbeBlock *next;
+} probe_block_t ;
+
+/* initial-execなので共有ライブラリでも__tls_get_addr()を呼ばない */
+extern __thread probe_block_t *probe_self __attribute__((tls_model("initial-exec")));
+probe_block_t *probe_attach(void);
+uint64_t probe_now(void);
+void probe_record(int, uint64_t);
+
+static inline void
+probe_count(int id, uint64_t n)
+{
+	probe_block_t *b = probe_self;
+
+	if (__builtin_expect(b == NULL, 0))  b = probe_attach();
+	__atomic_store_n(&b->count[id], __atomic_load_n(&b->count[id], __ATOMIC_RELAXED) + n,
+	                 __ATOMIC_RELAXED);
+}
+
+/* PROBE_SAMPLE回に1回だけ時刻を返す。それ以外は0 */
+static inline uint64_t
+probe_timer_start(int id)
+{
+	probe_block_t *b = probe_self;
+
+	if (__builtin_expect(b == NULL, 0))  b = probe_attach();
+	return (b->tick[id]++ % PROBE_SAMPLE) ? 0 : probe_now();
+}
+
+static inline void
+probe_timer_stop(int id, uint64_t t0)
+{
+	if (t0 != 0)  probe_record(id, probe_now() - t0);
+}
+
+#define PROBE_COUNT(id, n)          probe_count(id, n)
+#define PROBE_TIMER_START(t, id)    uint64_t t = probe_timer_start(id)
+#define PROBE_TIMER_STOP(t, id)     probe_timer_stop(id, t)
+/* 配列版のループの中では局所変数に足し，ループの後でPROBE_COUNT()する。
+ * 計数器には書かないのでループはそのままベクトル化され，入力を2度読まない */
+#define PROBE_TALLY_DECL(n)         int n = 0
+#define PROBE_TALLY(n, c)           ((n) += (c))
+#else
+#define PROBE_COUNT(id, n)          ((void)0)
+#define PROBE_TIMER_START(t, id)    /* 何もしない */
+#define PROBE_TIMER_STOP(t, id)     ((void)0)
+#define PROBE_TALLY_DECL(n)         /* 何もしない */
+#define PROBE_TALLY(n, c)           ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROBE_H */
@@ -1,281 +1,1197 @@
-/***********************************************************
-	quadrant -- 象限
-***********************************************************/
-#include <math.h> /* fpclassify(), atan(), atan2() */
-#define PI 3.14159265358979323846
-
-double
-quadrant(double x, double y)
-{
-	double atanxy = 0.0;
-	int kind = 0;  // 0:= arg, 1:= quadrant, 2:= radian
-	int quadrant = 0;
-
-	switch (fpclassify(y)) {
-	case FP_NAN:
-		return NAN;
-		break;
-	case FP_INFINITE:
-		// switch radian
-		kind = 2;
-		break;
-	case FP_ZERO:
-	case FP_SUBNORMAL:
-		// switch argument of complex
-		kind = 0;
-		break;
-	default:
-		// switch quadrant
-		kind = 1;
-		break;
-	}
-	switch (fpclassify(x)) {
-	case FP_NAN:
-		return NAN;
-		break;
-	case FP_INFINITE:
-		switch (kind) {
-		case 0:
-			kind = 0;  // re-correction to kind is complex argument
-			quadrant = -1;  // mark zero
-			break;
-		case 1:
-			kind = 2;  // re-correction to kind is radian
-			quadrant = x < 0 ? 7 : 5;
-			break;
-		case 2:
-			quadrant = y >= 0 ? x >= 0 ? 1 : 2 : x < 0 ? 3 : 4;
-			break;
-		default:
-			break;
-		}
-		break;
-	case FP_ZERO:
-	case FP_SUBNORMAL:
-		switch (kind) {
-		case 0:
-			quadrant = -3;
-			break;
-		case 1:
-		case 2:
-			kind = 0;  // re-correction to kind is arg
-			quadrant = -2;  // calculate complex-arg
-			break;
-		default:
-			break;
-		}
-		break;
-	default:
-		switch (kind) {
-		case 0:
-			quadrant = -1;  // calculate complex-absolute
-			break;
-		case 1:
-			quadrant = y >= 0 ? x >= 0 ? 1 : 2 : x < 0 ? 3 : 4;
-			x = fabs(x); y = fabs(y);
-			break;
-		case 2: // y is infinite and x is finite
-			quadrant = y < 0 ? 8 : 6;
-			break;
-		default:
-			break;
-		}
-		break;
-	}
-	switch (kind) {
-	case 0:  // arg
-		switch (quadrant) {
-		case -1:  // Absolute
-			return x < 0 ? PI : 0;  // $\pi$
-			break;
-		case -2:  // Arg
-			return y < 0 ? -0.5 * PI : 0.5 * PI;  // $\frac{1}{2}\pi$
-			break;
-		case -3:
-			return 0.0; // arg(0+0i) is originally the undefined but returns 0.0
-			break;
-		default:
-			break;
-		}
-		break;
-	case 1:  // quadrant
-		atanxy = atan(y / x);
-		switch (quadrant) {
-		case 1:
-			return atanxy;
-			break;
-		case 2:
-			return PI - atanxy;
-			break;
-		case 3:
-			return atanxy - PI;
-			break;
-		case 4:
-			return -atanxy;
-			break;
-		default:
-			break;
-		}
-		break;
-	case 2:  // radian
-		switch (quadrant) {
-		case 1: // 1st: $45^{\circ}$
-			return 0.25 * PI;
-			break;
-		case 2: // 2nd: $-45^{\circ}$
-			return 3.0/4.0 * PI;
-			break;
-		case 3: // 3rd: $-135^{\circ}$
-			return -3.0/4.0 * PI;
-			break;
-		case 4: // 4th: $135^{\circ}$
-			return -0.25 * PI;
-			break;
-		case 5: // $\rm{just} 0^{\circ}$
-			return y < 0 ? -0.0 : 0.0; // 0-deg is originally the undefined but return 0
-			break;
-		case 6: // $\rm{just} 90^{\circ}$
-			return 0.5 * PI; // $\frac{1}{2}\pi$
-			break;
-		case 7: // $\rm{just} 180^{\circ}$
-			return y < 0 ? -PI : PI; // $\frac{1}{2}\pi$
-			break;
-		case 8: // $\rm{just} 270^{\circ}$
-			return -0.5 * PI; // $\neg\frac{1}{2}\pi$
-			break;
-		default:
-			break;
-		}
-		break;
-	default:
-		return NAN;
-		break;
-	}
-	return NAN;
-}
-
-
-/******************************************************************************/
-// 以下はテスト
-#include <stdio.h>
-#include <stdlib.h>
-#include <float.h>
-
-#define A_SIZE 8
-#define B_SIZE 4
-#define C_SIZE 12
-
-// List
-static const char at[] = "complex argument switched by zero";
-static const char bt[] = "quadrant switched by finite";
-static const char ct[] = "radian switched by infinite";
-static const double ax[A_SIZE]  = { 0.0, 1.0, 0.0, -1.0, 0.0, 0.0, HUGE_VAL, -HUGE_VAL };
-static const double ay[A_SIZE]  = { 1.0, 0.0, -1.0, 0.0, HUGE_VAL, -HUGE_VAL, 0.0, 0.0 };
-static const double bx[B_SIZE]  = { 1.0, 1.0, -1.0, -1.0 };
-static const double by[B_SIZE]  = { 1.0, -1.0, -1.0, 1.0 };
-static const double cx[C_SIZE] =
-{
-	1.0, -1.0, HUGE_VAL, HUGE_VAL, HUGE_VAL, HUGE_VAL,
-	1.0, -HUGE_VAL, -HUGE_VAL, -HUGE_VAL, -HUGE_VAL, -1.0
-};
-static const double cy[C_SIZE] =
-{
-	HUGE_VAL, HUGE_VAL, HUGE_VAL, 1.0, -1.0, -HUGE_VAL,
-	-HUGE_VAL, HUGE_VAL, 1.0, -1.0, -HUGE_VAL, -HUGE_VAL
-};
-static const char cs[C_SIZE][9] =
-{
-	{' ', ' ', ' ', '0', 'd', 'e', 'g', ':', ' '},
-	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
-	{' ', ' ', '4', '5', 'd', 'e', 'g', ':', ' '},
-	{' ', ' ', '9', '0', 'd', 'e', 'g', ':', ' '},
-	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
-	{' ', '1', '3', '5', 'd', 'e', 'g', ':', ' '},
-	{' ', '1', '8', '0', 'd', 'e', 'g', ':', ' '},
-	{' ', '-', '4', '5', 'd', 'e', 'g', ':', ' '},
-	{' ', '-', '9', '0', 'd', 'e', 'g', ':', ' '},
-	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
-	{'-', '1', '3', '5', 'd', 'e', 'g', ':', ' '},
-	{'-', '1', '8', '0', 'd', 'e', 'g', ':', ' '}
-};
-
-// Prototypes
-static char *eval_print(double, double);
-static char *quadrant_print(double, double);
-static char *atan2_print(double, double);
-static void quadrant_list_print(void);
-
-int
-main(void)
-{
-	quadrant_list_print();
-	return 0;
-}
-
-static char *
-quadrant_print(double x, double y)
-{
-	static char s[0x100];
-
-	snprintf(s, 0x100, "% *.*f\n", DBL_DIG, DBL_DIG, quadrant(x, y));
-
-	return s;
-}
-
-static char *
-atan2_print(double x, double y)
-{
-	static char s[0x100];
-
-	snprintf(s, 0x100, "% *.*f\n", DBL_DIG, DBL_DIG, atan2(y, x));
-
-	return s;
-}
-
-static char *
-eval_print(const double x, const double y)
-{
-	static char s[0x100];
-	
-	snprintf(s, 0x100, "quadrant(% 1.1f, % 1.1f)", x, y);
-
-	return s;
-}
-
-static void
-quadrant_list_print(void)
-{
-	printf("%s\n", at);
-	for (volatile int i = 0; i < A_SIZE; i++)
-	{
-		const double quadrant_x = ax[i];
-		const double quadrant_y = ay[i];
-		printf("  %20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
-	}
-	puts("");
-	printf("%s\n", bt);
-	for (volatile int i = 0; i < B_SIZE; i++)
-	{
-		const double quadrant_x = bx[i];
-		const double quadrant_y = by[i];
-		printf("  %20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
-	}
-	puts("");
-	printf("%s\n", ct);
-	for (volatile int i = 0; i < C_SIZE; i++)
-	{
-		const double quadrant_x = cx[i];
-		const double quadrant_y = cy[i];
-		printf("  ");
-		for (volatile int j = 0; j < 9; j++)
-			printf("%c", cs[i][j]);
-		printf(" ");
-		printf("%20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
-		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
-	}
-}
+/***********************************************************
+	quadrant -- 象限
+***********************************************************/
+#define _GNU_SOURCE  /* sysconf(), sincos() */
+#include <math.h> /* fpclassify(), atan(), atan2(), hypot(), sin(), cos() */
+#include <float.h> /* DBL_MIN, FLT_MIN */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h> /* memcpy() */
+#include <pthread.h>
+#include <unistd.h> /* sysconf() */
+#include "algomath.h"
+#define PI 3.14159265358979323846
+
+double
+quadrant(double x, double y)
+{
+	double atanxy = 0.0;
+	int kind = 0;  // 0:= arg, 1:= quadrant, 2:= radian
+	int quadrant = 0;
+
+	switch (fpclassify(y)) {
+	case FP_NAN:
+		return NAN;
+		break;
+	case FP_INFINITE:
+		// switch radian
+		kind = 2;
+		break;
+	case FP_ZERO:
+	case FP_SUBNORMAL:
+		// switch argument of complex
+		kind = 0;
+		break;
+	default:
+		// switch quadrant
+		kind = 1;
+		break;
+	}
+	switch (fpclassify(x)) {
+	case FP_NAN:
+		return NAN;
+		break;
+	case FP_INFINITE:
+		switch (kind) {
+		case 0:
+			kind = 0;  // re-correction to kind is complex argument
+			quadrant = -1;  // mark zero
+			break;
+		case 1:
+			kind = 2;  // re-correction to kind is radian
+			quadrant = x < 0 ? 7 : 5;
+			break;
+		case 2:
+			quadrant = y >= 0 ? x >= 0 ? 1 : 2 : x < 0 ? 3 : 4;
+			break;
+		default:
+			break;
+		}
+		break;
+	case FP_ZERO:
+	case FP_SUBNORMAL:
+		switch (kind) {
+		case 0:
+			quadrant = -3;
+			break;
+		case 1:
+		case 2:
+			kind = 0;  // re-correction to kind is arg
+			quadrant = -2;  // calculate complex-arg
+			break;
+		default:
+			break;
+		}
+		break;
+	default:
+		switch (kind) {
+		case 0:
+			quadrant = -1;  // calculate complex-absolute
+			break;
+		case 1:
+			quadrant = y >= 0 ? x >= 0 ? 1 : 2 : x < 0 ? 3 : 4;
+			x = fabs(x); y = fabs(y);
+			break;
+		case 2: // y is infinite and x is finite
+			quadrant = y < 0 ? 8 : 6;
+			break;
+		default:
+			break;
+		}
+		break;
+	}
+	switch (kind) {
+	case 0:  // arg
+		switch (quadrant) {
+		case -1:  // Absolute
+			return x < 0 ? PI : 0;  // $\pi$
+			break;
+		case -2:  // Arg
+			return y < 0 ? -0.5 * PI : 0.5 * PI;  // $\frac{1}{2}\pi$
+			break;
+		case -3:
+			return 0.0; // arg(0+0i) is originally the undefined but returns 0.0
+			break;
+		default:
+			break;
+		}
+		break;
+	case 1:  // quadrant
+		atanxy = atan(y / x);
+		switch (quadrant) {
+		case 1:
+			return atanxy;
+			break;
+		case 2:
+			return PI - atanxy;
+			break;
+		case 3:
+			return atanxy - PI;
+			break;
+		case 4:
+			return -atanxy;
+			break;
+		default:
+			break;
+		}
+		break;
+	case 2:  // radian
+		switch (quadrant) {
+		case 1: // 1st: $45^{\circ}$
+			return 0.25 * PI;
+			break;
+		case 2: // 2nd: $-45^{\circ}$
+			return 3.0/4.0 * PI;
+			break;
+		case 3: // 3rd: $-135^{\circ}$
+			return -3.0/4.0 * PI;
+			break;
+		case 4: // 4th: $135^{\circ}$
+			return -0.25 * PI;
+			break;
+		case 5: // $\rm{just} 0^{\circ}$
+			return y < 0 ? -0.0 : 0.0; // 0-deg is originally the undefined but return 0
+			break;
+		case 6: // $\rm{just} 90^{\circ}$
+			return 0.5 * PI; // $\frac{1}{2}\pi$
+			break;
+		case 7: // $\rm{just} 180^{\circ}$
+			return y < 0 ? -PI : PI; // $\frac{1}{2}\pi$
+			break;
+		case 8: // $\rm{just} 270^{\circ}$
+			return -0.5 * PI; // $\neg\frac{1}{2}\pi$
+			break;
+		default:
+			break;
+		}
+		break;
+	default:
+		return NAN;
+		break;
+	}
+	return NAN;
+}
+
+/* 単精度版。非正規数は単精度の基準で0とみなす */
+float
+quadrantf(float x, float y)
+{
+	if (fpclassify(x) == FP_SUBNORMAL)  x = 0;
+	if (fpclassify(y) == FP_SUBNORMAL)  y = 0;
+	return (float)quadrant(x, y);
+}
+
+/*******************************************************************************
+	配列版 -- 分岐なしの分類とベクトルのアークタンジェント
+	上のswitchの表をまとめると，非正規数を0に潰した$|x|$, $|y|$について
+	$\theta = \arctan(|y|/|x|) \in [0, \frac{\pi}{2}]$ (無限大同士は$\frac{\pi}{4}$，
+	0同士は0)を求め，$x$が負(0類でない)なら$\pi - \theta$，$y$が負(0類でない)なら
+	符号を反転すれば，どの場合も同じ値になる。NaNは最後に差し込む。
+	$\arctan$は$t = \min/\max \in [0, 1]$に持ち込み，$t > 0.66$なら
+	$\frac{\pi}{4} + \arctan\frac{t-1}{t+1}$とし，Cephesのミニマックス有理式
+	(単精度は多項式)を使う。$|y| > |x|$なら$\frac{\pi}{2} - \theta$。
+*******************************************************************************/
+#define QD_P0 -8.750608600031904122785e-01
+#define QD_P1 -1.615753718733365076637e+01
+#define QD_P2 -7.500855792314704667340e+01
+#define QD_P3 -1.228866684490136173410e+02
+#define QD_P4 -6.485021904942025371773e+01
+#define QD_Q0  2.485846490142306297962e+01
+#define QD_Q1  1.650270098316988542046e+02
+#define QD_Q2  4.328810604912902668951e+02
+#define QD_Q3  4.853903996359136964868e+02
+#define QD_Q4  1.945506571482613964425e+02
+#define QD_PIO4     7.85398163397448278999e-01
+#define QD_PIO2     1.57079632679489655800e+00
+#define QD_MOREBITS 6.123233995736765886130e-17  /* $\frac{\pi}{2}$の下位 */
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define QD_DLEN 8
+#define QD_FLEN 16
+typedef __m512d qd_dvec_t;
+typedef __m512  qd_fvec_t;
+typedef __mmask8  qd_dmask_t;
+typedef __mmask16 qd_fmask_t;
+#define qd_dset1(a)         _mm512_set1_pd(a)
+#define qd_dload(p)         _mm512_loadu_pd(p)
+#define qd_dstore(p, a)     _mm512_storeu_pd(p, a)
+#define qd_dadd(a, b)       _mm512_add_pd(a, b)
+#define qd_dsub(a, b)       _mm512_sub_pd(a, b)
+#define qd_dmul(a, b)       _mm512_mul_pd(a, b)
+#define qd_ddiv(a, b)       _mm512_div_pd(a, b)
+#define qd_dmin(a, b)       _mm512_min_pd(a, b)
+#define qd_dmax(a, b)       _mm512_max_pd(a, b)
+#define qd_dabs(a)          _mm512_abs_pd(a)
+#define qd_dsqrt(a)         _mm512_sqrt_pd(a)
+#define qd_dcmp(a, b, op)   _mm512_cmp_pd_mask(a, b, op)
+#define qd_dsel(m, a, b)    _mm512_mask_blend_pd(m, a, b)  /* m ? b : a */
+#define qd_fset1(a)         _mm512_set1_ps(a)
+#define qd_fload(p)         _mm512_loadu_ps(p)
+#define qd_fstore(p, a)     _mm512_storeu_ps(p, a)
+#define qd_fadd(a, b)       _mm512_add_ps(a, b)
+#define qd_fsub(a, b)       _mm512_sub_ps(a, b)
+#define qd_fmul(a, b)       _mm512_mul_ps(a, b)
+#define qd_fdiv(a, b)       _mm512_div_ps(a, b)
+#define qd_fmin(a, b)       _mm512_min_ps(a, b)
+#define qd_fmax(a, b)       _mm512_max_ps(a, b)
+#define qd_fabs(a)          _mm512_abs_ps(a)
+#define qd_fcmp(a, b, op)   _mm512_cmp_ps_mask(a, b, op)
+#define qd_fsel(m, a, b)    _mm512_mask_blend_ps(m, a, b)
+#define qd_dround(a)        _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define qd_dfloor(a)        _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define qd_dmor(a, b)       ((a) | (b))
+#define qd_dmandn(a, b)     ((a) & ~(b))  /* a && !b */
+#define qd_dmall(m)         ((m) == 0xFF)
+#elif defined(__AVX2__)
+#define QD_DLEN 4
+#define QD_FLEN 8
+typedef __m256d qd_dvec_t;
+typedef __m256  qd_fvec_t;
+typedef __m256d qd_dmask_t;
+typedef __m256  qd_fmask_t;
+#define qd_dset1(a)         _mm256_set1_pd(a)
+#define qd_dload(p)         _mm256_loadu_pd(p)
+#define qd_dstore(p, a)     _mm256_storeu_pd(p, a)
+#define qd_dadd(a, b)       _mm256_add_pd(a, b)
+#define qd_dsub(a, b)       _mm256_sub_pd(a, b)
+#define qd_dmul(a, b)       _mm256_mul_pd(a, b)
+#define qd_ddiv(a, b)       _mm256_div_pd(a, b)
+#define qd_dmin(a, b)       _mm256_min_pd(a, b)
+#define qd_dmax(a, b)       _mm256_max_pd(a, b)
+#define qd_dabs(a)          _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define qd_dsqrt(a)         _mm256_sqrt_pd(a)
+#define qd_dcmp(a, b, op)   _mm256_cmp_pd(a, b, op)
+#define qd_dsel(m, a, b)    _mm256_blendv_pd(a, b, m)
+#define qd_dround(a)        _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define qd_dfloor(a)        _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define qd_dmor(a, b)       _mm256_or_pd(a, b)
+#define qd_dmandn(a, b)     _mm256_andnot_pd(b, a)
+#define qd_dmall(m)         (_mm256_movemask_pd(m) == 0xF)
+#define qd_fset1(a)         _mm256_set1_ps(a)
+#define qd_fload(p)         _mm256_loadu_ps(p)
+#define qd_fstore(p, a)     _mm256_storeu_ps(p, a)
+#define qd_fadd(a, b)       _mm256_add_ps(a, b)
+#define qd_fsub(a, b)       _mm256_sub_ps(a, b)
+#define qd_fmul(a, b)       _mm256_mul_ps(a, b)
+#define qd_fdiv(a, b)       _mm256_div_ps(a, b)
+#define qd_fmin(a, b)       _mm256_min_ps(a, b)
+#define qd_fmax(a, b)       _mm256_max_ps(a, b)
+#define qd_fabs(a)          _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+#define qd_fcmp(a, b, op)   _mm256_cmp_ps(a, b, op)
+#define qd_fsel(m, a, b)    _mm256_blendv_ps(a, b, m)
+#endif
+
+#ifdef QD_DLEN
+/* ベクトル1本分の極座標: 偏角quadrant(x, y)を返し，*rに大きさ$\sqrt{x^2+y^2}$を置く。
+ * $t = \min/\max$を大きさと偏角で共用する。大きさは$\max\sqrt{1+t^2}$なのであふれない。
+ * 0類(非正規数を含む)は偏角と同じく大きさでも0とみなすので，$t$はその時点で0になり，
+ * $|y| > |x|$の入れ替えもyが0類でないときだけになる。
+ */
+static inline qd_dvec_t
+qd_dpolar(qd_dvec_t x, qd_dvec_t y, qd_dvec_t *r)
+{
+	const qd_dvec_t zero = qd_dset1(0.0), one = qd_dset1(1.0), inf = qd_dset1(HUGE_VAL);
+	qd_dvec_t ax = qd_dabs(x), ay = qd_dabs(y), mn, mx, t, u, z, p, q, th;
+	qd_dmask_t zx, zy, eq, big, swap, xneg, yneg, nan;
+
+	/* 分類: 非正規数は0類に，負は0類でないものだけ */
+	zx = qd_dcmp(ax, qd_dset1(DBL_MIN), _CMP_LT_OQ);
+	zy = qd_dcmp(ay, qd_dset1(DBL_MIN), _CMP_LT_OQ);
+	xneg = qd_dcmp(x, qd_dset1(-DBL_MIN), _CMP_LE_OQ);
+	yneg = qd_dcmp(y, qd_dset1(-DBL_MIN), _CMP_LE_OQ);
+	swap = qd_dmandn(qd_dcmp(ay, ax, _CMP_GT_OQ), zy);
+	nan = qd_dcmp(x, y, _CMP_UNORD_Q);
+	ax = qd_dsel(zx, ax, zero);
+	ay = qd_dsel(zy, ay, zero);
+
+	/* $t = \min/\max$。等しければ1 (無限大同士)，どちらも0なら0 */
+	mn = qd_dmin(ax, ay);
+	mx = qd_dmax(ax, ay);
+	eq = qd_dcmp(ax, ay, _CMP_EQ_OQ);
+	t = qd_ddiv(qd_dsel(eq, mn, one), qd_dsel(eq, mx, one));
+	t = qd_dsel(qd_dcmp(mx, zero, _CMP_EQ_OQ), t, zero);
+
+	/* 大きさ。NaNはhypot()に合わせ，もう一方が無限大なら無限大 */
+	*r = qd_dmul(mx, qd_dsqrt(qd_dadd(one, qd_dmul(t, t))));
+	*r = qd_dsel(nan, *r, qd_dadd(x, y));
+	*r = qd_dsel(qd_dmor(qd_dcmp(ax, inf, _CMP_EQ_OQ), qd_dcmp(ay, inf, _CMP_EQ_OQ)), *r, inf);
+
+	/* $\arctan t$ */
+	big = qd_dcmp(t, qd_dset1(0.66), _CMP_GT_OQ);
+	u = qd_dsel(big, t, qd_ddiv(qd_dsub(t, one), qd_dadd(t, one)));
+	z = qd_dmul(u, u);
+	p = qd_dadd(qd_dmul(qd_dset1(QD_P0), z), qd_dset1(QD_P1));
+	p = qd_dadd(qd_dmul(p, z), qd_dset1(QD_P2));
+	p = qd_dadd(qd_dmul(p, z), qd_dset1(QD_P3));
+	p = qd_dadd(qd_dmul(p, z), qd_dset1(QD_P4));
+	q = qd_dadd(z, qd_dset1(QD_Q0));
+	q = qd_dadd(qd_dmul(q, z), qd_dset1(QD_Q1));
+	q = qd_dadd(qd_dmul(q, z), qd_dset1(QD_Q2));
+	q = qd_dadd(qd_dmul(q, z), qd_dset1(QD_Q3));
+	q = qd_dadd(qd_dmul(q, z), qd_dset1(QD_Q4));
+	th = qd_dadd(u, qd_dmul(u, qd_ddiv(qd_dmul(z, p), q)));
+	th = qd_dsel(big, th, qd_dadd(qd_dset1(QD_PIO4), qd_dadd(th, qd_dset1(0.5 * QD_MOREBITS))));
+
+	/* 象限へ */
+	th = qd_dsel(swap, th, qd_dadd(qd_dsub(qd_dset1(QD_PIO2), th), qd_dset1(QD_MOREBITS)));
+	th = qd_dsel(xneg, th, qd_dadd(qd_dsub(qd_dset1(2 * QD_PIO2), th), qd_dset1(2 * QD_MOREBITS)));
+	th = qd_dsel(yneg, th, qd_dmul(th, qd_dset1(-1.0)));
+	return qd_dsel(nan, th, qd_dadd(x, y));
+}
+
+/* ベクトル1本分のquadrant(x, y) */
+static inline qd_dvec_t
+qd_dkernel(qd_dvec_t x, qd_dvec_t y)
+{
+	qd_dvec_t r;
+
+	return qd_dpolar(x, y, &r);
+}
+
+/* 単精度: Cephesのatanfの多項式 */
+static inline qd_fvec_t
+qd_fkernel(qd_fvec_t x, qd_fvec_t y)
+{
+	const qd_fvec_t zero = qd_fset1(0.0f), one = qd_fset1(1.0f);
+	qd_fvec_t ax = qd_fabs(x), ay = qd_fabs(y), mn, mx, t, u, z, p, th;
+	qd_fmask_t eq, big, swap, xneg, yneg;
+
+	ax = qd_fsel(qd_fcmp(ax, qd_fset1(FLT_MIN), _CMP_LT_OQ), ax, zero);
+	ay = qd_fsel(qd_fcmp(ay, qd_fset1(FLT_MIN), _CMP_LT_OQ), ay, zero);
+	xneg = qd_fcmp(x, qd_fset1(-FLT_MIN), _CMP_LE_OQ);
+	yneg = qd_fcmp(y, qd_fset1(-FLT_MIN), _CMP_LE_OQ);
+	swap = qd_fcmp(ay, ax, _CMP_GT_OQ);
+
+	mn = qd_fmin(ax, ay);
+	mx = qd_fmax(ax, ay);
+	eq = qd_fcmp(ax, ay, _CMP_EQ_OQ);
+	t = qd_fdiv(qd_fsel(eq, mn, one), qd_fsel(eq, mx, one));
+	t = qd_fsel(qd_fcmp(mx, zero, _CMP_EQ_OQ), t, zero);
+
+	big = qd_fcmp(t, qd_fset1(0.4142135623730950f), _CMP_GT_OQ);
+	u = qd_fsel(big, t, qd_fdiv(qd_fsub(t, one), qd_fadd(t, one)));
+	z = qd_fmul(u, u);
+	p = qd_fsub(qd_fmul(qd_fset1(8.05374449538e-2f), z), qd_fset1(1.38776856032e-1f));
+	p = qd_fadd(qd_fmul(p, z), qd_fset1(1.99777106478e-1f));
+	p = qd_fsub(qd_fmul(p, z), qd_fset1(3.33329491539e-1f));
+	th = qd_fadd(qd_fmul(qd_fmul(p, z), u), u);
+	th = qd_fsel(big, th, qd_fadd(th, qd_fset1((float)QD_PIO4)));
+
+	th = qd_fsel(swap, th, qd_fsub(qd_fset1((float)QD_PIO2), th));
+	th = qd_fsel(xneg, th, qd_fsub(qd_fset1((float)(2 * QD_PIO2)), th));
+	th = qd_fsel(yneg, th, qd_fmul(th, qd_fset1(-1.0f)));
+	return qd_fsel(qd_fcmp(x, y, _CMP_UNORD_Q), th, qd_fadd(x, y));
+}
+#endif
+
+/* 配列版 out[i] = quadrant(x[i], y[i]) */
+void
+quadrant_batch(int len, const double *x, const double *y, double *out)
+{
+	int i = 0;
+
+#ifdef QD_DLEN
+	for (; i + QD_DLEN <= len; i += QD_DLEN)
+		qd_dstore(out + i, qd_dkernel(qd_dload(x + i), qd_dload(y + i)));
+#endif
+	for (; i < len; i++)
+		out[i] = quadrant(x[i], y[i]);
+}
+
+/* 単精度の配列版 */
+void
+quadrantf_batch(int len, const float *x, const float *y, float *out)
+{
+	int i = 0;
+
+#ifdef QD_FLEN
+	for (; i + QD_FLEN <= len; i += QD_FLEN)
+		qd_fstore(out + i, qd_fkernel(qd_fload(x + i), qd_fload(y + i)));
+#endif
+	for (; i < len; i++)
+		out[i] = quadrantf(x[i], y[i]);
+}
+
+/*******************************************************************************
+	極座標との変換
+	cart2polar()は偏角をquadrant()の分類のまま，大きさをhypot()の代わりに
+	同じループで求めるので，メモリを1回しか通らない。polar2cart()は$\sin$と$\cos$を
+	1回の引き算で作る。$\theta$を$k\frac{\pi}{2} + u$ ($|u| \leq \frac{\pi}{4}$)に分け
+	(Cody-Waite，$\frac{\pi}{2}$を33ビットずつ3つに)，fdlibmのカーネルの多項式で
+	$\sin u$, $\cos u$を求めて，$k \bmod 4$で入れ替えと符号を決める。
+	$|\theta| \geq 2^{19}\frac{\pi}{2}$のレーンがあればそのベクトルは1要素ずつsincos()に
+	回す。端数の要素とベクトルのない翻訳でも同じ引き算と多項式をスカラーで使う。
+*******************************************************************************/
+#define QD_PIO2_1   1.57079632673412561417e+00  /* $\frac{\pi}{2}$の上位33ビット */
+#define QD_PIO2_2   6.07710050630396597660e-11
+#define QD_PIO2_3   2.02226624871116645580e-21
+#define QD_S1 -1.66666666666666324348e-01
+#define QD_S2  8.33333333332248946124e-03
+#define QD_S3 -1.98412698298579493134e-04
+#define QD_S4  2.75573137070700676789e-06
+#define QD_S5 -2.50507602534068634195e-08
+#define QD_S6  1.58969099521155010221e-10
+#define QD_C1  4.16666666666666019037e-02
+#define QD_C2 -1.38888888888741095749e-03
+#define QD_C3  2.48015872894767294178e-05
+#define QD_C4 -2.75573143513906633035e-07
+#define QD_C5  2.08757232129817482790e-09
+#define QD_C6 -1.13596475577881948265e-11
+
+#ifdef QD_DLEN
+/* $\sin\theta$, $\cos\theta$を一度に */
+static inline void
+qd_dsincos(qd_dvec_t th, qd_dvec_t *s, qd_dvec_t *c)
+{
+	const qd_dvec_t one = qd_dset1(1.0);
+	qd_dvec_t k, n, u, z, ps, pc, hz, w, sn, cs;
+	qd_dmask_t odd, sneg, cneg;
+
+	k = qd_dround(qd_dmul(th, qd_dset1(2 / PI)));
+	u = qd_dsub(th, qd_dmul(k, qd_dset1(QD_PIO2_1)));
+	u = qd_dsub(u, qd_dmul(k, qd_dset1(QD_PIO2_2)));
+	u = qd_dsub(u, qd_dmul(k, qd_dset1(QD_PIO2_3)));
+	n = qd_dsub(k, qd_dmul(qd_dset1(4.0), qd_dfloor(qd_dmul(k, qd_dset1(0.25)))));  /* 0..3 */
+
+	z = qd_dmul(u, u);
+	ps = qd_dadd(qd_dmul(qd_dset1(QD_S6), z), qd_dset1(QD_S5));
+	ps = qd_dadd(qd_dmul(ps, z), qd_dset1(QD_S4));
+	ps = qd_dadd(qd_dmul(ps, z), qd_dset1(QD_S3));
+	ps = qd_dadd(qd_dmul(ps, z), qd_dset1(QD_S2));
+	ps = qd_dadd(qd_dmul(ps, z), qd_dset1(QD_S1));
+	sn = qd_dadd(u, qd_dmul(qd_dmul(u, z), ps));
+	pc = qd_dadd(qd_dmul(qd_dset1(QD_C6), z), qd_dset1(QD_C5));
+	pc = qd_dadd(qd_dmul(pc, z), qd_dset1(QD_C4));
+	pc = qd_dadd(qd_dmul(pc, z), qd_dset1(QD_C3));
+	pc = qd_dadd(qd_dmul(pc, z), qd_dset1(QD_C2));
+	pc = qd_dadd(qd_dmul(pc, z), qd_dset1(QD_C1));
+	hz = qd_dmul(qd_dset1(0.5), z);
+	w = qd_dsub(one, hz);  /* fdlibmの__kernel_cosと同じく$1 - z/2$の丸めを拾う */
+	cs = qd_dadd(w, qd_dadd(qd_dsub(qd_dsub(one, w), hz), qd_dmul(qd_dmul(z, z), pc)));
+
+	odd = qd_dmor(qd_dcmp(n, one, _CMP_EQ_OQ), qd_dcmp(n, qd_dset1(3.0), _CMP_EQ_OQ));
+	sneg = qd_dcmp(n, qd_dset1(2.0), _CMP_GE_OQ);
+	cneg = qd_dmor(qd_dcmp(n, one, _CMP_EQ_OQ), qd_dcmp(n, qd_dset1(2.0), _CMP_EQ_OQ));
+	*s = qd_dsel(odd, sn, cs);
+	*c = qd_dsel(odd, cs, sn);
+	*s = qd_dsel(sneg, *s, qd_dmul(*s, qd_dset1(-1.0)));
+	*c = qd_dsel(cneg, *c, qd_dmul(*c, qd_dset1(-1.0)));
+}
+
+/* 複素数の並び(re, im, re, im, ...)をreとimに分ける */
+static inline void
+qd_dload2(const double *p, qd_dvec_t *re, qd_dvec_t *im)
+{
+#if defined(__AVX512F__)
+	const __m512i ire = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+	const __m512i iim = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+	qd_dvec_t a = qd_dload(p), b = qd_dload(p + QD_DLEN);
+
+	*re = _mm512_permutex2var_pd(a, ire, b);
+	*im = _mm512_permutex2var_pd(a, iim, b);
+#else
+	qd_dvec_t a = qd_dload(p), b = qd_dload(p + QD_DLEN);
+
+	*re = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+	*im = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+#endif
+}
+#endif
+
+/* スカラー版の極座標。qd_dpolar()と同じく$t = \min/\max$を大きさと偏角で共用し，
+ * 0類の扱いも同じにする。hypot()とquadrant()を別々に呼ぶより割り算が1回で済む */
+static inline double
+qd_polar(double x, double y, double *r)
+{
+	double ax = fabs(x), ay = fabs(y), mn, mx, t, th;
+
+	if (x != x || y != y)
+	{
+		*r = hypot(x, y);  /* もう一方が無限大なら無限大 */
+		return x + y;
+	}
+	if (ax < DBL_MIN)  ax = 0;
+	if (ay < DBL_MIN)  ay = 0;
+	mn = ax < ay ? ax : ay;
+	mx = ax < ay ? ay : ax;
+	t = ax == ay ? (mx == 0 ? 0 : 1) : mn / mx;
+	*r = mx * sqrt(1.0 + t * t);
+	th = atan(t);
+	if (ay > ax)  th = 0.5 * PI - th;
+	if (x <= -DBL_MIN)  th = PI - th;
+	if (y <= -DBL_MIN)  th = -th;
+	return th;
+}
+
+/* スカラー版の$\sin\theta$, $\cos\theta$。qd_dsincos()と同じ引き算と多項式で，
+ * 大きな$\theta$は(あれば)sincos()に1回で回す */
+static inline void
+qd_sincos(double th, double *s, double *c)
+{
+	static const double sgn[4][2] = { { 1, 1 }, { 1, -1 }, { -1, -1 }, { -1, 1 } };  /* sin, cos */
+	double k, u, z, ps, pc, hz, w, sn, cs;
+	int n;
+
+	if (!(fabs(th) < 524288 * QD_PIO2))
+	{
+#ifdef __GLIBC__
+		sincos(th, s, c);
+#else
+		*s = sin(th);  *c = cos(th);
+#endif
+		return;
+	}
+	k = (th * (2 / PI) + 0x1.8p52) - 0x1.8p52;  /* 最も近い整数 ($|k| < 2^{19}$) */
+	u = th - k * QD_PIO2_1;
+	u -= k * QD_PIO2_2;
+	u -= k * QD_PIO2_3;
+	z = u * u;
+	ps = ((((QD_S6 * z + QD_S5) * z + QD_S4) * z + QD_S3) * z + QD_S2) * z + QD_S1;
+	sn = u + u * z * ps;
+	pc = ((((QD_C6 * z + QD_C5) * z + QD_C4) * z + QD_C3) * z + QD_C2) * z + QD_C1;
+	hz = 0.5 * z;
+	w = 1.0 - hz;
+	cs = w + (((1.0 - w) - hz) + z * z * pc);
+	n = (int)k & 3;  /* 分岐は読めないので表と選択で */
+	*s = sgn[n][0] * (n & 1 ? cs : sn);
+	*c = sgn[n][1] * (n & 1 ? sn : cs);
+}
+
+/* 直交座標(x, y)から極座標(r, theta)へ。theta[i] = quadrant(x[i], y[i])
+ * 0類(非正規数を含む)の成分は大きさでも0とみなす */
+void
+cart2polar(const double *x, const double *y, double *r, double *theta, int n)
+{
+	int i = 0;
+
+#ifdef QD_DLEN
+	for (; i + QD_DLEN <= n; i += QD_DLEN)
+	{
+		qd_dvec_t vr;
+
+		qd_dstore(theta + i, qd_dpolar(qd_dload(x + i), qd_dload(y + i), &vr));
+		qd_dstore(r + i, vr);
+	}
+#endif
+	for (; i < n; i++)
+		theta[i] = qd_polar(x[i], y[i], &r[i]);
+}
+
+/* 複素数の並びz = (re, im, re, im, ...)の版。n は複素数の個数 */
+void
+cart2polar_complex(const double *z, double *r, double *theta, int n)
+{
+	int i = 0;
+
+#ifdef QD_DLEN
+	for (; i + QD_DLEN <= n; i += QD_DLEN)
+	{
+		qd_dvec_t re, im, vr;
+
+		qd_dload2(z + 2 * i, &re, &im);
+		qd_dstore(theta + i, qd_dpolar(re, im, &vr));
+		qd_dstore(r + i, vr);
+	}
+#endif
+	for (; i < n; i++)
+		theta[i] = qd_polar(z[2 * i], z[2 * i + 1], &r[i]);
+}
+
+/* 極座標(r, theta)から直交座標(x, y)へ */
+void
+polar2cart(const double *r, const double *theta, double *x, double *y, int n)
+{
+	double sn, cs;
+	int i = 0, j;
+
+#ifdef QD_DLEN
+	for (; i + QD_DLEN <= n; i += QD_DLEN)
+	{
+		qd_dvec_t th = qd_dload(theta + i), vr = qd_dload(r + i), s, c;
+
+		if (qd_dmall(qd_dcmp(qd_dabs(th), qd_dset1(524288 * QD_PIO2), _CMP_LT_OQ)))
+		{
+			qd_dsincos(th, &s, &c);
+			qd_dstore(x + i, qd_dmul(vr, c));
+			qd_dstore(y + i, qd_dmul(vr, s));
+		}
+		else
+			for (j = i; j < i + QD_DLEN; j++)
+			{
+				qd_sincos(theta[j], &sn, &cs);
+				x[j] = r[j] * cs;
+				y[j] = r[j] * sn;
+			}
+	}
+#endif
+	for (j = i; j < n; j++)
+	{
+		qd_sincos(theta[j], &sn, &cs);
+		x[j] = r[j] * cs;
+		y[j] = r[j] * sn;
+	}
+}
+
+/*******************************************************************************
+	分類だけ -- quadrant_classify()
+	quadrant()の途中で求めるkind (0:複素偏角, 1:象限, 2:角度)とquadrant (-3..8)の
+	組を，0..15の符号にまとめて返す。アークタンジェントは呼ばない。
+	    0: NaN
+	    1: 複素偏角, 0+0i (-3)    2: 複素偏角, xが0 (-2)    3: 複素偏角, yが0 (-1)
+	  4-7: 象限1..4             8-11: 角度, 無限大同士の象限1..4
+	   12: 角度, x = +inf (5)     13: y = +inf (6)    14: x = -inf (7)    15: y = -inf (8)
+	x, yをそれぞれ0類(非正規数を含む)・有限・無限大・NaNの0..3に分け，符号と合わせた
+	$16c_y + 4c_x + 2[y<0] + [x<0]$で表を引くので分岐はない。
+*******************************************************************************/
+
+static const int qd_class_table[64] = {  /* gatherで引くのでint */
+	 1,  1,  1,  1,  /* y:0類  x:0類 */
+	 3,  3,  3,  3,  /* y:0類  x:有限 */
+	 3,  3,  3,  3,  /* y:0類  x:無限大 */
+	 0,  0,  0,  0,  /* y:0類  x:NaN */
+	 2,  2,  2,  2,  /* y:有限 x:0類 */
+	 4,  5,  7,  6,  /* y:有限 x:有限 */
+	12, 14, 12, 14,  /* y:有限 x:無限大 */
+	 0,  0,  0,  0,
+	 2,  2,  2,  2,  /* y:無限大 x:0類 */
+	13, 13, 15, 15,  /* y:無限大 x:有限 */
+	 8,  9, 11, 10,  /* y:無限大 x:無限大 */
+	 0,  0,  0,  0,
+	 0,  0,  0,  0,  /* y:NaN */
+	 0,  0,  0,  0,
+	 0,  0,  0,  0,
+	 0,  0,  0,  0
+};
+static const signed char qd_code_kind[QUADRANT_NCODES] = {
+	-1, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2
+};
+static const signed char qd_code_quadrant[QUADRANT_NCODES] = {
+	 0, -3, -2, -1, 1, 2, 3, 4, 1, 2, 3, 4, 5, 6, 7, 8
+};
+
+/* 0..3: 0類・有限・無限大・NaN */
+static inline int
+qd_class(double x)
+{
+	double a = fabs(x);
+
+	return (a >= DBL_MIN) + (a == HUGE_VAL) + 3 * (x != x);
+}
+
+/* quadrant(x, y)の分類符号 */
+int
+quadrant_classify(double x, double y)
+{
+	return qd_class_table[16 * qd_class(y) + 4 * qd_class(x) + 2 * (y < 0) + (x < 0)];
+}
+
+/* 分類符号からkindとquadrantに戻す。NaNはkind = -1 */
+void
+quadrant_decode(int code, int *kind, int *quadrant)
+{
+	*kind = qd_code_kind[code & (QUADRANT_NCODES - 1)];
+	*quadrant = qd_code_quadrant[code & (QUADRANT_NCODES - 1)];
+}
+
+#ifdef QD_DLEN
+/* ベクトル1本分の表の添字 */
+static inline qd_dvec_t
+qd_dclass_index(qd_dvec_t x, qd_dvec_t y)
+{
+	const qd_dvec_t zero = qd_dset1(0.0), one = qd_dset1(1.0), inf = qd_dset1(HUGE_VAL);
+	qd_dvec_t ax = qd_dabs(x), ay = qd_dabs(y), cx, cy;
+
+	cx = qd_dadd(qd_dsel(qd_dcmp(ax, qd_dset1(DBL_MIN), _CMP_GE_OQ), zero, one),
+	             qd_dsel(qd_dcmp(ax, inf, _CMP_EQ_OQ), zero, one));
+	cx = qd_dadd(cx, qd_dsel(qd_dcmp(x, x, _CMP_UNORD_Q), zero, qd_dset1(3.0)));
+	cy = qd_dadd(qd_dsel(qd_dcmp(ay, qd_dset1(DBL_MIN), _CMP_GE_OQ), zero, one),
+	             qd_dsel(qd_dcmp(ay, inf, _CMP_EQ_OQ), zero, one));
+	cy = qd_dadd(cy, qd_dsel(qd_dcmp(y, y, _CMP_UNORD_Q), zero, qd_dset1(3.0)));
+	return qd_dadd(qd_dadd(qd_dmul(cy, qd_dset1(16.0)), qd_dmul(cx, qd_dset1(4.0))),
+	               qd_dadd(qd_dsel(qd_dcmp(y, zero, _CMP_LT_OQ), zero, qd_dset1(2.0)),
+	                       qd_dsel(qd_dcmp(x, zero, _CMP_LT_OQ), zero, one)));
+}
+#endif
+
+/* 配列版 code[i] = quadrant_classify(x[i], y[i])
+ * 添字を倍精度のレーンで作り，整数に直してgatherで表を引く。
+ */
+void
+quadrant_classify_batch(int len, const double *x, const double *y, unsigned char *code)
+{
+	int i = 0;
+
+#ifdef QD_DLEN
+#if defined(__AVX512F__)
+	for (; i + QD_DLEN <= len; i += QD_DLEN)
+	{
+		__m256i k = _mm512_cvtpd_epi32(qd_dclass_index(qd_dload(x + i), qd_dload(y + i)));
+		__m256i c = _mm256_i32gather_epi32(qd_class_table, k, 4);
+		__m128i w = _mm_packs_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+
+		_mm_storel_epi64((__m128i *)(code + i), _mm_packus_epi16(w, w));
+	}
+#else
+	for (; i + QD_DLEN <= len; i += QD_DLEN)
+	{
+		__m128i k = _mm256_cvtpd_epi32(qd_dclass_index(qd_dload(x + i), qd_dload(y + i)));
+		__m128i c = _mm_i32gather_epi32(qd_class_table, k, 4), w = _mm_packs_epi32(c, c);
+		int b = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+
+		memcpy(code + i, &b, 4);
+	}
+#endif
+#endif
+	for (; i < len; i++)
+		code[i] = (unsigned char)quadrant_classify(x[i], y[i]);
+}
+
+/* 分類の度数 -- スレッドごとの私有の表に数えて最後に足す */
+typedef struct QuadrantHistTask {
+	const double *x, *y;
+	int lo, hi;
+	uint64_t counts[QUADRANT_NCODES];
+} quadrant_hist_task_t;
+
+static void *
+quadrant_histogram_worker(void *arg)
+{
+	enum { CHUNK = 1024 };
+	quadrant_hist_task_t *task = arg;
+	unsigned char code[CHUNK];
+	uint64_t c[QUADRANT_NCODES] = { 0 };
+	int i, j, m;
+
+	for (i = task->lo; i < task->hi; i += m)
+	{
+		m = task->hi - i < CHUNK ? task->hi - i : CHUNK;
+		quadrant_classify_batch(m, task->x + i, task->y + i, code);
+		for (j = 0; j < m; j++)
+			c[code[j]]++;
+	}
+	memcpy(task->counts, c, sizeof c);
+	return NULL;
+}
+
+/* counts[0..QUADRANT_NCODES-1]に分類ごとの個数を入れる。引数が不正なら-1 */
+int
+quadrant_histogram(const double *x, const double *y, int n, uint64_t counts[])
+{
+	enum { MIN_PER_THREAD = 1 << 16 };
+	quadrant_hist_task_t *task;
+	pthread_t *th;
+	int i, j, nthreads, started;
+
+	if (n < 0 || (n && (x == NULL || y == NULL)) || counts == NULL)
+		return -1;
+	nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > n / MIN_PER_THREAD)
+		nthreads = n / MIN_PER_THREAD;
+	if (nthreads < 1)
+		nthreads = 1;
+	task = malloc(sizeof(quadrant_hist_task_t) * nthreads);
+	th = malloc(sizeof(pthread_t) * nthreads);
+	if (task == NULL || th == NULL)
+	{
+		free(task);
+		free(th);
+		return -1;
+	}
+	for (i = 0; i < nthreads; i++)
+	{
+		task[i].x = x;  task[i].y = y;
+		task[i].lo = (int)((long long)n * i / nthreads);
+		task[i].hi = (int)((long long)n * (i + 1) / nthreads);
+	}
+	started = 0;
+	for (; started < nthreads - 1; started++)
+		if (pthread_create(&th[started], NULL, quadrant_histogram_worker, &task[started]) != 0)
+			break;  /* 作れなかった分は呼び出し側のスレッドが受け持つ */
+	for (i = started; i < nthreads; i++)
+		quadrant_histogram_worker(&task[i]);
+	for (i = 0; i < started; i++)
+		pthread_join(th[i], NULL);
+	for (j = 0; j < QUADRANT_NCODES; j++)
+		for (counts[j] = 0, i = 0; i < nthreads; i++)
+			counts[j] += task[i].counts[j];
+	free(task);
+	free(th);
+	return 0;
+}
+
+
+/******************************************************************************/
+#ifndef ALGO_NO_MAIN  /* 他のプログラムに組み込むときは-DALGO_NO_MAIN */
+// 以下はテスト
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <string.h>
+#include <time.h>
+
+#define A_SIZE 8
+#define B_SIZE 4
+#define C_SIZE 12
+
+// List
+static const char at[] = "complex argument switched by zero";
+static const char bt[] = "quadrant switched by finite";
+static const char ct[] = "radian switched by infinite";
+static const double ax[A_SIZE]  = { 0.0, 1.0, 0.0, -1.0, 0.0, 0.0, HUGE_VAL, -HUGE_VAL };
+static const double ay[A_SIZE]  = { 1.0, 0.0, -1.0, 0.0, HUGE_VAL, -HUGE_VAL, 0.0, 0.0 };
+static const double bx[B_SIZE]  = { 1.0, 1.0, -1.0, -1.0 };
+static const double by[B_SIZE]  = { 1.0, -1.0, -1.0, 1.0 };
+static const double cx[C_SIZE] =
+{
+	1.0, -1.0, HUGE_VAL, HUGE_VAL, HUGE_VAL, HUGE_VAL,
+	1.0, -HUGE_VAL, -HUGE_VAL, -HUGE_VAL, -HUGE_VAL, -1.0
+};
+static const double cy[C_SIZE] =
+{
+	HUGE_VAL, HUGE_VAL, HUGE_VAL, 1.0, -1.0, -HUGE_VAL,
+	-HUGE_VAL, HUGE_VAL, 1.0, -1.0, -HUGE_VAL, -HUGE_VAL
+};
+static const char cs[C_SIZE][9] =
+{
+	{' ', ' ', ' ', '0', 'd', 'e', 'g', ':', ' '},
+	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
+	{' ', ' ', '4', '5', 'd', 'e', 'g', ':', ' '},
+	{' ', ' ', '9', '0', 'd', 'e', 'g', ':', ' '},
+	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
+	{' ', '1', '3', '5', 'd', 'e', 'g', ':', ' '},
+	{' ', '1', '8', '0', 'd', 'e', 'g', ':', ' '},
+	{' ', '-', '4', '5', 'd', 'e', 'g', ':', ' '},
+	{' ', '-', '9', '0', 'd', 'e', 'g', ':', ' '},
+	{' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '},
+	{'-', '1', '3', '5', 'd', 'e', 'g', ':', ' '},
+	{'-', '1', '8', '0', 'd', 'e', 'g', ':', ' '}
+};
+
+// Prototypes
+static char *eval_print(double, double);
+static char *quadrant_print(double, double);
+static char *atan2_print(double, double);
+static void quadrant_list_print(void);
+static void quadrant_batch_demo(void);
+static void polar_demo(void);
+static void classify_demo(void);
+
+int
+main(void)
+{
+	quadrant_list_print();
+	quadrant_batch_demo();
+	polar_demo();
+	classify_demo();
+	return 0;
+}
+
+static char *
+quadrant_print(double x, double y)
+{
+	static char s[0x100];
+
+	snprintf(s, 0x100, "% *.*f\n", DBL_DIG, DBL_DIG, quadrant(x, y));
+
+	return s;
+}
+
+static char *
+atan2_print(double x, double y)
+{
+	static char s[0x100];
+
+	snprintf(s, 0x100, "% *.*f\n", DBL_DIG, DBL_DIG, atan2(y, x));
+
+	return s;
+}
+
+static char *
+eval_print(const double x, const double y)
+{
+	static char s[0x100];
+	
+	snprintf(s, 0x100, "quadrant(% 1.1f, % 1.1f)", x, y);
+
+	return s;
+}
+
+static void
+quadrant_list_print(void)
+{
+	printf("%s\n", at);
+	for (volatile int i = 0; i < A_SIZE; i++)
+	{
+		const double quadrant_x = ax[i];
+		const double quadrant_y = ay[i];
+		printf("  %20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
+	}
+	puts("");
+	printf("%s\n", bt);
+	for (volatile int i = 0; i < B_SIZE; i++)
+	{
+		const double quadrant_x = bx[i];
+		const double quadrant_y = by[i];
+		printf("  %20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
+	}
+	puts("");
+	printf("%s\n", ct);
+	for (volatile int i = 0; i < C_SIZE; i++)
+	{
+		const double quadrant_x = cx[i];
+		const double quadrant_y = cy[i];
+		printf("  ");
+		for (volatile int j = 0; j < 9; j++)
+			printf("%c", cs[i][j]);
+		printf(" ");
+		printf("%20.22s = %*.*s | atan2: %*.*s\n", eval_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, quadrant_print(quadrant_x, quadrant_y),
+		       DBL_DIG + 2, DBL_DIG + 2, atan2_print(quadrant_x, quadrant_y));
+	}
+}
+/* 配列版: 特殊値の総当たりとスカラー版との誤差，atan2との速さ比べ */
+static void
+quadrant_batch_demo(void)
+{
+	enum { LEN = 1 << 16, REP = 32, NS = 11 };
+	static const double sp[NS] = {
+		0.0, -0.0, 1e-310, -1e-310, 1.0, -1.0, 2.5, -2.5, HUGE_VAL, -HUGE_VAL, NAN
+	};
+	static double xs[LEN], ys[LEN], out[LEN];
+	static float xf[LEN], yf[LEN], outf[LEN];
+	volatile double sink = 0;
+	double err, maxd = 0, maxf = 0;
+	clock_t c0, c1, c2, c3, c4;
+	int i, j, r, bad = 0;
+
+	for (i = 0; i < NS; i++)  /* 特殊値: 符号つきの0まで一致するか */
+		for (j = 0; j < NS; j++)
+		{
+			xs[i * NS + j] = sp[i];
+			ys[i * NS + j] = sp[j];
+		}
+	quadrant_batch(NS * NS, xs, ys, out);
+	for (i = 0; i < NS * NS; i++)
+	{
+		double e = quadrant(xs[i], ys[i]);
+		if (fabs(out[i] - e) > 2 * DBL_EPSILON * fabs(e) || signbit(out[i]) != signbit(e)
+		    || isnan(out[i]) != isnan(e))
+		{
+			printf("  special mismatch: quadrant(%g, %g) = %.17g, batch %.17g\n",
+			       xs[i], ys[i], e, out[i]);
+			bad++;
+		}
+	}
+	printf("\nbatch: %d special-case mismatches / %d\n", bad, NS * NS);
+
+	srand(4);
+	for (i = 0; i < LEN; i++)
+	{
+		xs[i] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20);
+		ys[i] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20);
+		xf[i] = (float)xs[i];
+		yf[i] = (float)ys[i];
+	}
+	quadrant_batch(LEN, xs, ys, out);
+	quadrantf_batch(LEN, xf, yf, outf);
+	for (i = 0; i < LEN; i++)  /* ulpは$\max(|f|, 1)$の刻みで測る */
+	{
+		double e = quadrant(xs[i], ys[i]);
+		double ef = quadrant(xf[i], yf[i]);
+		err = fabs(out[i] - e) / (DBL_EPSILON * fmax(fabs(e), 1));
+		if (err > maxd)  maxd = err;
+		err = fabs(outf[i] - ef) / (FLT_EPSILON * fmax(fabs(ef), 1));
+		if (err > maxf)  maxf = err;
+	}
+	c0 = clock();
+	for (r = 0; r < REP; r++)
+		for (i = 0; i < LEN; i++)  out[i] = atan2(ys[i], xs[i]);
+	c1 = clock();
+	for (r = 0; r < REP; r++)
+		for (i = 0; i < LEN; i++)  out[i] = quadrant(xs[i], ys[i]);
+	c2 = clock();
+	for (r = 0; r < REP; r++)
+		quadrant_batch(LEN, xs, ys, out);
+	c3 = clock();
+	for (r = 0; r < REP; r++)
+		quadrantf_batch(LEN, xf, yf, outf);
+	c4 = clock();
+	sink += out[0] + outf[0];
+	printf("batch: max error %.2f ulp (double), %.2f ulp (float)\n", maxd, maxf);
+	printf("atan2 %.2f ns, quadrant %.2f ns, quadrant_batch %.2f ns, quadrantf_batch %.2f ns\n",
+	       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN / REP,
+	       1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c4 - c3) / CLOCKS_PER_SEC / LEN / REP);
+}
+
+/* 極座標との変換: hypot()+quadrant()の2回回しと比べる */
+static void
+polar_demo(void)
+{
+	enum { LEN = 1 << 16, REP = 32 };
+	static double xs[LEN], ys[LEN], zs[2 * LEN], r[LEN], th[LEN], r2[LEN], th2[LEN], x2[LEN], y2[LEN];
+	static const double sx[8] = { 1e300, 1e-310, HUGE_VAL, NAN, 0.0, -3.0, 1e-320, -HUGE_VAL };
+	static const double sy[8] = { -1e300, 1e-310, NAN, HUGE_VAL, -0.0, 4.0, 0.0, -2.0 };
+	volatile double sink = 0;
+	double err, maxr = 0, maxt = 0, maxc = 0;
+	clock_t c0, c1, c2, c3, c4;
+	int i, j, bad = 0;
+
+	srand(5);
+	for (i = 0; i < LEN; i++)
+	{
+		xs[i] = zs[2 * i] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20);
+		ys[i] = zs[2 * i + 1] = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20);
+	}
+	for (i = 0; i < 8; i++)
+	{
+		xs[i] = zs[2 * i] = sx[i];
+		ys[i] = zs[2 * i + 1] = sy[i];
+	}
+	cart2polar(xs, ys, r, th, LEN);
+	cart2polar_complex(zs, r2, th2, LEN);
+	for (i = 0; i < LEN; i++)
+	{
+		double fx = fabs(xs[i]) < DBL_MIN ? 0 : xs[i], fy = fabs(ys[i]) < DBL_MIN ? 0 : ys[i];
+		double h = hypot(fx, fy), q = quadrant(xs[i], ys[i]);  /* 0類は大きさでも0 */
+		if (memcmp(&r[i], &r2[i], sizeof r[i]) || memcmp(&th[i], &th2[i], sizeof th[i]))
+			bad++;
+		if (isnan(h) != isnan(r[i]) || isnan(q) != isnan(th[i]))
+			bad++;
+		else if (!isnan(h))
+		{
+			err = h == r[i] ? 0 : fabs(r[i] - h) / (DBL_EPSILON * h);
+			if (err > maxr)  maxr = err;
+			err = fabs(th[i] - q) / (DBL_EPSILON * fmax(fabs(q), 1));
+			if (err > maxt)  maxt = err;
+		}
+	}
+	for (i = 0; i < 8; i++)
+		printf("  cart2polar(%g, %g) = (%g, %.17g)\n", xs[i], ys[i], r[i], th[i]);
+	polar2cart(r + 8, th + 8, x2, y2, LEN - 8);  /* 往復 */
+	for (i = 8; i < LEN; i++)
+	{
+		err = fmax(fabs(x2[i - 8] - r[i] * cos(th[i])), fabs(y2[i - 8] - r[i] * sin(th[i])))
+		      / (DBL_EPSILON * r[i]);
+		if (err > maxc)  maxc = err;
+	}
+	{  /* 大きな角度はsincos()に回るのでlibmと一致する */
+		static const double one[4] = { 1, 1, 1, 1 }, big[4] = { 1e6, -3e7, 1e22, 1e300 };
+		double bx[4], by[4];
+
+		polar2cart(one, big, bx, by, 4);
+		for (i = 0; i < 4; i++)
+			if (bx[i] != cos(big[i]) || by[i] != sin(big[i]))
+				bad++;
+	}
+	printf("cart2polar: %d mismatches, max error r %.2f ulp, theta %.2f ulp; polar2cart %.2f ulp of r\n",
+	       bad, maxr, maxt, maxc);
+
+	c0 = clock();
+	for (j = 0; j < REP; j++)
+	{
+		for (i = 0; i < LEN; i++)  r2[i] = hypot(xs[i], ys[i]);
+		for (i = 0; i < LEN; i++)  th2[i] = atan2(ys[i], xs[i]);
+	}
+	c1 = clock();
+	for (j = 0; j < REP; j++)
+		cart2polar(xs, ys, r, th, LEN);
+	c2 = clock();
+	for (j = 0; j < REP; j++)
+		cart2polar_complex(zs, r, th, LEN);
+	c3 = clock();
+	for (j = 0; j < REP; j++)
+		polar2cart(r, th, x2, y2, LEN);
+	c4 = clock();
+	for (j = 0; j < REP; j++)
+		for (i = 0; i < LEN; i++)
+		{
+			x2[i] = r[i] * cos(th[i]);
+			y2[i] = r[i] * sin(th[i]);
+		}
+	sink += r2[0] + th2[0] + x2[0];
+	printf("hypot+atan2 %.2f ns, cart2polar %.2f ns, cart2polar_complex %.2f ns, "
+	       "polar2cart %.2f ns, r*cos/r*sin %.2f ns\n",
+	       1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN / REP,
+	       1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN / REP, 1e9 * (c4 - c3) / CLOCKS_PER_SEC / LEN / REP,
+	       1e9 * (clock() - c4) / CLOCKS_PER_SEC / LEN / REP);
+}
+
+/* 分類符号が角度と食い違わないか */
+static int
+classify_agrees(int code, double q)
+{
+	switch (code) {
+	case 0:  return isnan(q);
+	case 1:  return q == 0;
+	case 2:  return fabs(q) == 0.5 * PI;
+	case 3:  return q == 0 || q == PI;
+	case 4:  return q >= 0 && q <= 0.5 * PI;
+	case 5:  return q >= 0.5 * PI && q <= PI;
+	case 6:  return q >= -PI && q <= -0.5 * PI;
+	case 7:  return q >= -0.5 * PI && q <= 0;
+	case 8:  return q == 0.25 * PI;
+	case 9:  return q == 0.75 * PI;
+	case 10: return q == -0.75 * PI;
+	case 11: return q == -0.25 * PI;
+	case 12: return q == 0;
+	case 13: return q == 0.5 * PI;
+	case 14: return fabs(q) == PI;
+	case 15: return q == -0.5 * PI;
+	default: return 0;
+	}
+}
+
+/* 分類と度数: 角度との整合，配列版とスカラー版の一致，速さ */
+static void
+classify_demo(void)
+{
+	enum { LEN = 1 << 20, NS = 11 };
+	static const double sp[NS] = {
+		0.0, -0.0, 1e-310, -1e-310, 1.0, -1.0, 2.5, -2.5, HUGE_VAL, -HUGE_VAL, NAN
+	};
+	static double xs[LEN], ys[LEN], out[LEN];
+	static unsigned char code[LEN];
+	uint64_t counts[QUADRANT_NCODES], ref[QUADRANT_NCODES] = { 0 }, total = 0;
+	volatile double sink = 0;
+	clock_t c0, c1, c2, c3;
+	int i, kind, quad, bad = 0;
+
+	srand(6);
+	for (i = 0; i < LEN; i++)  /* 1割は特殊値を混ぜる */
+	{
+		xs[i] = rand() % 10 ? ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20) : sp[rand() % NS];
+		ys[i] = rand() % 10 ? ldexp((double)rand() / RAND_MAX - 0.5, rand() % 40 - 20) : sp[rand() % NS];
+	}
+	for (i = 0; i < NS * NS; i++)
+	{
+		xs[i] = sp[i / NS];
+		ys[i] = sp[i % NS];
+	}
+	quadrant_classify_batch(LEN, xs, ys, code);
+	for (i = 0; i < LEN; i++)
+	{
+		int c = quadrant_classify(xs[i], ys[i]);
+		if (c != code[i] || !classify_agrees(c, quadrant(xs[i], ys[i])))
+			bad++;
+		ref[c]++;
+	}
+	quadrant_histogram(xs, ys, LEN, counts);
+	printf("\nclassify: %d mismatches / %d\n", bad, LEN);
+	for (i = 0; i < QUADRANT_NCODES; i++)
+	{
+		quadrant_decode(i, &kind, &quad);
+		printf("  code %2d (kind %2d, quadrant %2d): %8llu%s\n", i, kind, quad,
+		       (unsigned long long)counts[i], counts[i] == ref[i] ? "" : " (differs)");
+		total += counts[i];
+	}
+	c0 = clock();
+	for (i = 0; i < LEN; i++)  out[i] = quadrant(xs[i], ys[i]);
+	c1 = clock();
+	quadrant_classify_batch(LEN, xs, ys, code);
+	c2 = clock();
+	quadrant_histogram(xs, ys, LEN, counts);
+	c3 = clock();
+	sink += out[LEN - 1];
+	printf("total %llu; quadrant %.2f ns, quadrant_classify_batch %.2f ns, quadrant_histogram %.2f ns (cpu)\n",
+	       (unsigned long long)total, 1e9 * (c1 - c0) / CLOCKS_PER_SEC / LEN,
+	       1e9 * (c2 - c1) / CLOCKS_PER_SEC / LEN, 1e9 * (c3 - c2) / CLOCKS_PER_SEC / LEN);
+}
+#endif /* ALGO_NO_MAIN */